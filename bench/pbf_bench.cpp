@@ -0,0 +1,358 @@
+#include"renderer.h"
+#include"renderer_types.h"
+
+#include<iostream>
+#include<fstream>
+#include<exception>
+#include<chrono>
+#include<string>
+#include<vector>
+#include<algorithm>
+#include<cmath>
+#include<numbers>
+
+#undef APIENTRY
+#ifdef _WIN32
+#define NOMINMAX
+#include<windows.h>
+#include<psapi.h>
+#else
+#include<sys/resource.h>
+#endif
+
+//headless throughput of the gpu solver over a range of scene sizes
+//runs on any vulkan device,a software one included:pick it with --device llvmpipe,
+//or point VK_ICD_FILENAMES at its icd json on machines without a gpu
+
+struct BenchConfig{
+    std::vector<uint32_t> sizes = {32768,262144};
+    uint32_t steps = 200;
+    uint32_t warmup = 20;
+    //steps per submission
+    uint32_t batch = 8;
+    float radius = 0.016f;
+    ParticleLayout layout = ParticleLayout::AOS;
+    //the fixed lists take 512 bytes per particle,too much for the big scenes
+    NeighborMode neighbors = NeighborMode::COMPACTLIST;
+    RadixsortMode sort = RadixsortMode::AUTO;
+    uint32_t iterations = 3;
+    bool profile = true;
+    bool stats = false;
+    bool validation = false;
+    std::string device;
+    std::string json;
+};
+
+struct BenchRun{
+    uint32_t particles = 0;
+    uint32_t steps = 0;
+    double seconds = 0;
+    VkDeviceSize peakdevicememory = 0;
+    uint64_t peakhostrss = 0;
+    //empty stages without profiling
+    RendererStats stats;
+};
+
+//of the whole process so far
+uint64_t GetPeakHostRss(){
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if(!GetProcessMemoryInfo(GetCurrentProcess(),&counters,sizeof(counters))){
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    if(getrusage(RUSAGE_SELF,&usage) != 0){
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss)*1024;
+#endif
+#endif
+}
+
+//32768,32k and 0.5M alike,k and M are powers of two
+uint32_t ParseCount(const std::string& text){
+    size_t end = 0;
+    double value = std::stod(text,&end);
+    std::string suffix = text.substr(end);
+    if(suffix == "k" || suffix == "K"){
+        value *= 1024;
+    }
+    else if(suffix == "m" || suffix == "M"){
+        value *= 1024*1024;
+    }
+    else if(!suffix.empty()){
+        throw std::runtime_error("unknown particle count suffix "+suffix+"!");
+    }
+    if(!(value >= 1)){
+        throw std::runtime_error("particle count should be positive!");
+    }
+    return static_cast<uint32_t>(value);
+}
+std::vector<uint32_t> ParseCounts(const std::string& text){
+    std::vector<uint32_t> counts;
+    size_t begin = 0;
+    while(begin <= text.size()){
+        size_t end = std::min(text.find(',',begin),text.size());
+        counts.push_back(ParseCount(text.substr(begin,end-begin)));
+        begin = end+1;
+    }
+    std::sort(counts.begin(),counts.end());
+    return counts;
+}
+
+//a dam break:exactly count particles at rest in one corner,filled layer by layer,the box twice as long as the block
+void SetupBenchScene(FluidSolver& solver,uint32_t count,float radius){
+    const float pi = std::numbers::pi_v<float>;
+    float diam = 2*radius;
+    UniformSimulatingObject simulatingobj{};
+    simulatingobj.dt = 1/240.0f;
+    simulatingobj.restDensity = 1.0f/(diam*diam*diam);
+    simulatingobj.sphRadius = 4*radius;
+    simulatingobj.coffPoly6 = 315.0f/(64*pi*std::pow(simulatingobj.sphRadius,3.0f));
+    simulatingobj.coffGradSpiky = -45/(pi*std::pow(simulatingobj.sphRadius,4.0f));
+    simulatingobj.coffSpiky = 15/(pi*std::pow(simulatingobj.sphRadius,3.0f));
+    simulatingobj.scorrK = 0.0001f;
+    simulatingobj.scorrQ = 0.1f;
+    simulatingobj.scorrN = 4;
+    solver.SetSimulatingObj(simulatingobj);
+
+    UniformNSObject nsobj{};
+    nsobj.sphRadius = 4*radius;
+    solver.SetNSObj(nsobj);
+
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+    uint32_t layers = (count+side*side-1)/(side*side);
+    float margin = diam;
+    std::vector<Particle> particles(count);
+    for(uint32_t i=0;i<count;++i){
+        Particle& particle = particles[i];
+        particle.Location = glm::vec3(margin)+diam*glm::vec3(i%side,i/(side*side),(i/side)%side);
+        particle.Mass = 1;
+        particle.NumNgbrs = 0;
+    }
+
+    float block = side*diam;
+    UniformBoxInfoObject boxinfoobj{};
+    boxinfoobj.clampX = glm::vec2{0,2*block+2*margin};
+    boxinfoobj.clampY = glm::vec2{0,std::max(1.5f*layers*diam,block)+2*margin};
+    boxinfoobj.clampZ = glm::vec2{0,block+2*margin};
+    boxinfoobj.clampX_still = boxinfoobj.clampX;
+    boxinfoobj.clampY_still = boxinfoobj.clampY;
+    boxinfoobj.clampZ_still = boxinfoobj.clampZ;
+    solver.SetBoxinfoObj(boxinfoobj);
+    //the box with a quarter of its size as margin,as SetupScene does
+    float box = std::max({boxinfoobj.clampX.y,boxinfoobj.clampY.y,boxinfoobj.clampZ.y});
+    solver.SetCompactDomain(glm::vec3(-0.25f*box),1.5f*box);
+
+    solver.SetParticles(particles);
+    solver.SetReorderInterval(16);
+}
+
+//a fresh device per size,so peak device memory belongs to that size alone
+BenchRun RunSize(const BenchConfig& config,uint32_t count,VkPhysicalDeviceProperties& properties){
+    Renderer renderer(800,800,config.validation);
+    renderer.SetHeadless(true);
+    if(!config.device.empty()){
+        renderer.SetPreferredDevice(config.device);
+    }
+    if(config.stats){
+        renderer.SetStatistics(true);
+    }
+    else if(config.profile){
+        renderer.SetProfiling(true);
+    }
+    FluidSolver& solver = renderer.GetSolver();
+    solver.SetParticleLayout(config.layout);
+    solver.SetNeighborMode(config.neighbors);
+    solver.SetRadixsortMode(config.sort);
+    solver.SetSolverIterations(config.iterations);
+    SetupBenchScene(solver,count,config.radius);
+    renderer.Init();
+    properties = renderer.GetDeviceProperties();
+
+    auto step = [&](uint32_t steps){
+        for(uint32_t done=0;done<steps;done+=config.batch){
+            solver.SimulateSteps(std::min(config.batch,steps-done));
+        }
+    };
+    step(config.warmup);
+    renderer.WaitIdle();
+    solver.ResetProfiler();
+    auto start = std::chrono::high_resolution_clock::now();
+    step(config.steps);
+    renderer.WaitIdle();
+    BenchRun run;
+    run.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+    run.steps = config.steps;
+    //before GetStats,whose copy test allocates buffers of its own
+    run.peakdevicememory = solver.GetPeakDeviceMemoryUsage();
+    if(config.profile || config.stats){
+        renderer.GetStats(run.stats);
+    }
+    run.particles = solver.GetParticleCount();
+    run.peakhostrss = GetPeakHostRss();
+    renderer.Cleanup();
+    return run;
+}
+
+void PrintRun(const BenchRun& run){
+    double stepspersecond = run.steps/run.seconds;
+    double nsperparticlestep = run.seconds*1e9/(static_cast<double>(run.particles)*run.steps);
+    printf("%9u particles %9.2f steps/s %8.3f ns/particle/step %9.1f MB device %9.1f MB host\n",run.particles,stepspersecond,nsperparticlestep,
+    run.peakdevicememory/1048576.0,run.peakhostrss/1048576.0);
+    for(auto& stage:run.stats.stages){
+        const GpuStageTiming& timing = stage.timing;
+        unsigned long long invocations = timing.vertexinvocations+timing.fragmentinvocations+timing.computeinvocations;
+        printf("    %-22s %8.3f ms %12llu inv %9.2f MB %8.1f GB/s\n",timing.name.c_str(),timing.average,invocations,
+        (stage.bytesread+stage.byteswritten)*1e-6,stage.bandwidth);
+    }
+}
+
+const char* GetDeviceTypeName(VkPhysicalDeviceType type){
+    switch(type){
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:return "cpu";
+    default:return "other";
+    }
+}
+
+//one object per run,stages as in RendererStats,times in ms
+void WriteJSON(const std::string& path,const BenchConfig& config,const VkPhysicalDeviceProperties& properties,const std::vector<BenchRun>& runs){
+    std::ofstream out(path);
+    if(!out){
+        throw std::runtime_error("failed to open "+path+"!");
+    }
+    const char* layouts[] = {"aos","soa","compact"};
+    const char* neighbors[] = {"list","cellwalk","compact"};
+    const char* sorts[] = {"auto","blelloch","onesweep","counting"};
+    out<<"{\n  \"device\":{\"name\":\""<<properties.deviceName<<"\",\"type\":\""<<GetDeviceTypeName(properties.deviceType)<<"\"},\n";
+    out<<"  \"config\":{\"steps\":"<<config.steps<<",\"warmup\":"<<config.warmup<<",\"batch\":"<<config.batch<<",\"radius\":"<<config.radius
+    <<",\"layout\":\""<<layouts[static_cast<int>(config.layout)]<<"\",\"neighbors\":\""<<neighbors[static_cast<int>(config.neighbors)]
+    <<"\",\"sort\":\""<<sorts[static_cast<int>(config.sort)]<<"\",\"iterations\":"<<config.iterations<<"},\n";
+    out<<"  \"runs\":[";
+    for(uint32_t i=0;i<runs.size();++i){
+        const BenchRun& run = runs[i];
+        out<<(i==0?"":",")<<"\n    {\"particles\":"<<run.particles<<",\"steps\":"<<run.steps<<",\"seconds\":"<<run.seconds
+        <<",\"steps_per_second\":"<<run.steps/run.seconds<<",\"ns_per_particle_step\":"<<run.seconds*1e9/(static_cast<double>(run.particles)*run.steps)
+        <<",\"peak_device_memory_bytes\":"<<run.peakdevicememory<<",\"peak_host_rss_bytes\":"<<run.peakhostrss
+        <<",\"copy_peak_gbps\":"<<run.stats.peakbandwidth<<",\"mean_neighbors\":"<<run.stats.neighbors<<",\"stages\":[";
+        for(uint32_t k=0;k<run.stats.stages.size();++k){
+            const GpuStageStats& stage = run.stats.stages[k];
+            const GpuStageTiming& timing = stage.timing;
+            out<<(k==0?"":",")<<"\n      {\"name\":\""<<timing.name<<"\",\"average_ms\":"<<timing.average<<",\"samples\":"<<timing.samples
+            <<",\"invocations\":"<<timing.vertexinvocations+timing.fragmentinvocations+timing.computeinvocations
+            <<",\"bytes\":"<<stage.bytesread+stage.byteswritten<<",\"gbps\":"<<stage.bandwidth<<"}";
+        }
+        out<<(run.stats.stages.empty()?"]}":"\n    ]}");
+    }
+    out<<(runs.empty()?"]\n}\n":"\n  ]\n}\n");
+}
+
+void PrintUsage(){
+    printf("pbf_bench [--particles 32k,256k,1M,4M] [--steps 200] [--warmup 20] [--batch 8] [--radius 0.016]\n"
+    "          [--layout aos|soa|compact] [--neighbors list|compact|cellwalk] [--sort auto|blelloch|onesweep|counting]\n"
+    "          [--iterations 3] [--stats] [--no-profile] [--device name] [--validation] [--json path]\n");
+}
+
+int main(int argc,char** argv){
+    try{
+        BenchConfig config;
+        for(int i=1;i<argc;++i){
+            std::string arg = argv[i];
+            std::string value = i+1<argc?argv[i+1]:"";
+            if(arg == "--help" || arg == "-h"){
+                PrintUsage();
+                return EXIT_SUCCESS;
+            }
+            else if(arg == "--stats"){
+                config.stats = true;
+            }
+            else if(arg == "--no-profile"){
+                config.profile = false;
+            }
+            else if(arg == "--validation"){
+                config.validation = true;
+            }
+            else if(i+1 >= argc){
+                PrintUsage();
+                return EXIT_FAILURE;
+            }
+            else if(arg == "--particles"){
+                config.sizes = ParseCounts(argv[++i]);
+            }
+            else if(arg == "--steps"){
+                config.steps = std::max(1ul,std::stoul(argv[++i]));
+            }
+            else if(arg == "--warmup"){
+                config.warmup = std::stoul(argv[++i]);
+            }
+            else if(arg == "--batch"){
+                config.batch = std::max(1ul,std::stoul(argv[++i]));
+            }
+            else if(arg == "--radius"){
+                config.radius = std::stof(argv[++i]);
+            }
+            else if(arg == "--iterations"){
+                config.iterations = std::stoul(argv[++i]);
+            }
+            else if(arg == "--device"){
+                config.device = argv[++i];
+            }
+            else if(arg == "--json"){
+                config.json = argv[++i];
+            }
+            else if(arg == "--layout"){
+                ++i;
+                if(value == "aos") config.layout = ParticleLayout::AOS;
+                else if(value == "soa") config.layout = ParticleLayout::SOA;
+                else if(value == "compact") config.layout = ParticleLayout::COMPACT;
+                else throw std::runtime_error("unknown layout "+value+"!");
+            }
+            else if(arg == "--neighbors"){
+                ++i;
+                if(value == "list") config.neighbors = NeighborMode::LIST;
+                else if(value == "compact") config.neighbors = NeighborMode::COMPACTLIST;
+                else if(value == "cellwalk") config.neighbors = NeighborMode::CELLWALK;
+                else throw std::runtime_error("unknown neighbor mode "+value+"!");
+            }
+            else if(arg == "--sort"){
+                ++i;
+                if(value == "auto") config.sort = RadixsortMode::AUTO;
+                else if(value == "blelloch") config.sort = RadixsortMode::BLELLOCH;
+                else if(value == "onesweep") config.sort = RadixsortMode::ONESWEEP;
+                else if(value == "counting") config.sort = RadixsortMode::COUNTING;
+                else throw std::runtime_error("unknown sort "+value+"!");
+            }
+            else{
+                PrintUsage();
+                return EXIT_FAILURE;
+            }
+        }
+
+        VkPhysicalDeviceProperties properties{};
+        std::vector<BenchRun> runs;
+        for(uint32_t size:config.sizes){
+            runs.push_back(RunSize(config,size,properties));
+            if(runs.size() == 1){
+                printf("%s (%s),%u steps after %u warm-up steps,%u per submission\n",properties.deviceName,GetDeviceTypeName(properties.deviceType),
+                config.steps,config.warmup,config.batch);
+            }
+            PrintRun(runs.back());
+        }
+        if(!config.json.empty()){
+            WriteJSON(config.json,config,properties,runs);
+        }
+    }
+    catch(std::runtime_error err){
+        std::cerr<<err.what()<<std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
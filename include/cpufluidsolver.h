@@ -0,0 +1,92 @@
+#ifndef CPUFLUIDSOLVER_H
+#define CPUFLUIDSOLVER_H
+#include"glm/glm.hpp"
+#include"renderer_types.h"
+#include"workerpool.h"
+#include"cpuneighborsearch.h"
+
+#include<vector>
+#include<memory>
+#include<cstdint>
+
+//the pbf step of FluidSolver on the host,for machines without a usable gpu and as the reference the kernels are checked against
+//every pass mirrors its compute shader,so the two stay comparable within fp32 rounding and summation order
+//particles live as one array per field and are put in cell order every step,the passes run over blocks of them on a WorkerPool
+class CpuFluidSolver{
+public:
+    CpuFluidSolver();
+    virtual ~CpuFluidSolver();
+public:
+    void Init();
+    void Cleanup();
+public:
+    void Simulate();
+    void SimulateSteps(uint32_t steps);
+public:
+    void SetSimulatingObj(const UniformSimulatingObject& sobj);
+    void SetBoxinfoObj(const UniformBoxInfoObject& bobj);
+    void SetParticles(const std::vector<Particle>& ps);
+    //same rules as FluidSolver::AddDomain
+    uint32_t AddDomain(const std::vector<Particle>& ps,const UniformSimulatingObject& sobj,const UniformBoxInfoObject& bobj);
+    void SetDomainSimulatingObj(uint32_t domain,const UniformSimulatingObject& sobj);
+    void SetDomainBoxinfoObj(uint32_t domain,const UniformBoxInfoObject& bobj);
+    void SetSolverIterations(uint32_t iterations);
+    void SetSubsteps(uint32_t substeps);
+    //0 uses every hardware thread
+    void SetThreadCount(uint32_t count);
+    //in upload order,like FluidSolver::GetParticles
+    void GetParticles(std::vector<Particle>& ps);
+public:
+    bool IsInitialized() const { return Initialized; }
+    uint32_t GetParticleCount() const { return static_cast<uint32_t>(id.size()); }
+    uint32_t GetThreadCount() const { return pool?pool->GetThreadCount():ThreadCount; }
+    static uint32_t GetSimdWidth();
+private:
+    void Euler(float dt);
+    void SearchNeighbors();
+    void ComputeLambda();
+    void ComputeDeltaLocation();
+    void UpdateLocation();
+    void UpdateVelocity(float dt);
+    void CacheVelocity();
+    void CorrectViscosity();
+    void CorrectVorticity(float dt);
+    //fn(begin,end,thread) over the live particles in blocks of PARTICLE_BLOCK_SIZE
+    template<typename F>
+    void ForParticleBlocks(const F& fn);
+
+    std::vector<Particle> particles;
+    UniformSimulatingObject simulatingobj{};
+    std::vector<UniformBoxInfoObject> boxinfobjs = std::vector<UniformBoxInfoObject>(1);
+    //restDensity and scorr of domain 0 are taken from simulatingobj
+    std::vector<FluidDomainObject> domainobjs = std::vector<FluidDomainObject>(1);
+    std::vector<uint32_t> domainsizes = std::vector<uint32_t>(1);
+    //particles one WorkerPool block covers,consecutive in cell order
+    static constexpr uint32_t PARTICLE_BLOCK_SIZE = 1024;
+
+    //one array per particle field,in cell order since the last search
+    std::vector<float> x,y,z;
+    //Location before the euler step,velocityupd reads it from the other flight on the gpu
+    std::vector<float> px,py,pz;
+    std::vector<float> vx,vy,vz;
+    std::vector<float> dx,dy,dz;
+    std::vector<float> tvx,tvy,tvz;
+    std::vector<float> lambda,density,mass;
+    std::vector<uint32_t> id;
+    //what SearchNeighbors permutes through
+    std::vector<float> scratch;
+    std::vector<uint32_t> scratchid;
+
+    //grid of the last search,whose cell order the particles are in
+    CpuNeighborSearch search;
+    //neighbors of particle i are ngbrs[ngbroffsets[i]..ngbroffsets[i+1])
+    std::vector<uint32_t> ngbroffsets;
+    std::vector<uint32_t> ngbrs;
+
+    std::unique_ptr<WorkerPool> pool;
+    uint32_t ThreadCount = 0;
+    uint32_t SolverIterations = 3;
+    uint32_t Substeps = 1;
+    bool Initialized = false;
+};
+#endif
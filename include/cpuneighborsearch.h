@@ -0,0 +1,97 @@
+#ifndef CPUNEIGHBORSEARCH_H
+#define CPUNEIGHBORSEARCH_H
+#include"glm/glm.hpp"
+#include"renderer_types.h"
+#include"workerpool.h"
+
+#include<vector>
+#include<algorithm>
+#include<cstdint>
+
+//cell linked list over a set of points,the host side of calcellhash,the cell sort and fixcellbuffer
+//points are counted into a dense grid over their bounds and put in cell order,stable within a cell
+//points of different fluid domains (the top bits of the particle id) are kept in separate cells and never see each other
+class CpuNeighborSearch{
+public:
+    //without a pool every pass runs on the calling thread
+    explicit CpuNeighborSearch(WorkerPool* pool = nullptr);
+public:
+    void SetPool(WorkerPool* pool);
+    //cells are at least cellsize wide,ids may be null for points of one domain
+    void Build(const float* x,const float* y,const float* z,const uint32_t* ids,uint32_t count,float cellsize);
+    void Build(const std::vector<Particle>& ps,float cellsize);
+    //neighbors within radius (at most the cell size) of every point of the last build,self excluded
+    //positions are in cell order:the i-th point's are ngbrs[offsets[i]..offsets[i+1]),indices of other points in cell order
+    void BuildNeighborLists(float radius,std::vector<uint32_t>& offsets,std::vector<uint32_t>& ngbrs);
+    //input indices of the points of domain within radius of location,any radius
+    void QueryRadius(glm::vec3 location,float radius,uint32_t domain,std::vector<uint32_t>& result) const;
+    //fn(input index,distance) for the same points
+    template<typename F>
+    void ForEachInRadius(glm::vec3 location,float radius,uint32_t domain,const F& fn) const;
+public:
+    uint32_t GetPointCount() const { return static_cast<uint32_t>(order.size()); }
+    //input index of the i-th point in cell order
+    const std::vector<uint32_t>& GetOrder() const { return order; }
+    //cell of the i-th point in cell order
+    const std::vector<uint32_t>& GetCellKeys() const { return cellkeys; }
+    glm::vec3 GetGridOrigin() const { return GridOrigin; }
+    glm::ivec3 GetGridSize() const { return GridSize; }
+    float GetCellSize() const { return CellSize; }
+private:
+    //fn(begin,end) over [0,count) in blocks of blocksize
+    template<typename F>
+    void ForBlocks(uint32_t count,uint32_t blocksize,const F& fn);
+    void ComputeGrid(const float* x,const float* y,const float* z,const uint32_t* ids,uint32_t count,float cellsize);
+    void SortCells(const float* x,const float* y,const float* z,const uint32_t* ids,uint32_t count);
+
+    WorkerPool* pool = nullptr;
+    //points one block of a pass covers
+    static constexpr uint32_t POINT_BLOCK_SIZE = 1024;
+    //cells one block of the prefix scan covers
+    static constexpr uint32_t CELL_BLOCK_SIZE = 16384;
+
+    glm::vec3 GridOrigin{0.0f};
+    float CellSize = 0.0f;
+    glm::ivec3 GridSize{1};
+    uint32_t DomainCount = 1;
+
+    //of the input points,in input order
+    std::vector<uint32_t> inputkeys;
+    std::vector<uint32_t> ranks;
+    //cellstart[k] is the first point of cell k in cell order,one past the last cell holds the count
+    std::vector<uint32_t> cellstart;
+    std::vector<uint32_t> blocksums;
+    //of the points in cell order
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> cellkeys;
+    std::vector<float> sx,sy,sz;
+    std::vector<std::vector<uint32_t>> blockngbrs;
+};
+
+template<typename F>
+void CpuNeighborSearch::ForEachInRadius(glm::vec3 location,float radius,uint32_t domain,const F& fn) const
+{
+    if(order.empty() || domain >= DomainCount){
+        return;
+    }
+    //cells touching the sphere,nothing when it misses the grid
+    glm::vec3 lo = (location-glm::vec3(radius)-GridOrigin)/CellSize;
+    glm::vec3 hi = (location+glm::vec3(radius)-GridOrigin)/CellSize;
+    if(hi.x < 0 || hi.y < 0 || hi.z < 0 || lo.x >= GridSize.x || lo.y >= GridSize.y || lo.z >= GridSize.z){
+        return;
+    }
+    glm::ivec3 c0 = glm::clamp(glm::ivec3(glm::max(lo,glm::vec3(0.0f))),glm::ivec3(0),GridSize-glm::ivec3(1));
+    glm::ivec3 c1 = glm::clamp(glm::ivec3(hi),glm::ivec3(0),GridSize-glm::ivec3(1));
+    for(int z=c0.z;z<=c1.z;++z){
+        for(int y=c0.y;y<=c1.y;++y){
+            uint32_t row = ((domain*GridSize.z+z)*GridSize.y+y)*GridSize.x;
+            for(uint32_t j=cellstart[row+c0.x];j<cellstart[row+c1.x+1];++j){
+                float distance = glm::length(glm::vec3(sx[j],sy[j],sz[j])-location);
+                if(distance < radius){
+                    fn(order[j],distance);
+                }
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,134 @@
+#ifndef CPUSIMD_H
+#define CPUSIMD_H
+#include<cstdint>
+#include<cmath>
+
+//lanes of fp32 for the kernels of CpuFluidSolver,8 with avx2,4 with neon on aarch64,1 otherwise
+//neighbor fields are gathered through SimdIndex,lanes past the end of a list are masked with SimdFirstLanes
+
+#if defined(__AVX2__)
+#include<immintrin.h>
+
+struct SimdFloat{ __m256 v; };
+using SimdMask = __m256;
+using SimdIndex = __m256i;
+constexpr uint32_t SIMD_WIDTH = 8;
+
+inline SimdFloat SimdBroadcast(float f){ return {_mm256_set1_ps(f)}; }
+inline SimdFloat SimdLoad(const float* p){ return {_mm256_loadu_ps(p)}; }
+inline void SimdStore(float* p,SimdFloat a){ _mm256_storeu_ps(p,a.v); }
+inline SimdIndex SimdLoadIndex(const uint32_t* p){ return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline SimdFloat SimdGather(const float* base,SimdIndex idx){ return {_mm256_i32gather_ps(base,idx,4)}; }
+inline SimdFloat operator+(SimdFloat a,SimdFloat b){ return {_mm256_add_ps(a.v,b.v)}; }
+inline SimdFloat operator-(SimdFloat a,SimdFloat b){ return {_mm256_sub_ps(a.v,b.v)}; }
+inline SimdFloat operator*(SimdFloat a,SimdFloat b){ return {_mm256_mul_ps(a.v,b.v)}; }
+inline SimdFloat operator/(SimdFloat a,SimdFloat b){ return {_mm256_div_ps(a.v,b.v)}; }
+inline SimdFloat SimdSqrt(SimdFloat a){ return {_mm256_sqrt_ps(a.v)}; }
+inline SimdMask SimdLess(SimdFloat a,SimdFloat b){ return _mm256_cmp_ps(a.v,b.v,_CMP_LT_OQ); }
+inline SimdMask SimdLessEqual(SimdFloat a,SimdFloat b){ return _mm256_cmp_ps(a.v,b.v,_CMP_LE_OQ); }
+inline SimdMask SimdAnd(SimdMask a,SimdMask b){ return _mm256_and_ps(a,b); }
+inline SimdFloat SimdSelect(SimdMask m,SimdFloat a,SimdFloat b){ return {_mm256_blendv_ps(b.v,a.v,m)}; }
+inline uint32_t SimdMaskBits(SimdMask m){ return static_cast<uint32_t>(_mm256_movemask_ps(m)); }
+inline SimdMask SimdFirstLanes(uint32_t n){
+    __m256i lanes = _mm256_setr_epi32(0,1,2,3,4,5,6,7);
+    return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(n)),lanes));
+}
+inline float SimdSum(SimdFloat a){
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a.v),_mm256_extractf128_ps(a.v,1));
+    s = _mm_add_ps(s,_mm_movehl_ps(s,s));
+    s = _mm_add_ss(s,_mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include<arm_neon.h>
+
+struct SimdFloat{ float32x4_t v; };
+using SimdMask = uint32x4_t;
+using SimdIndex = uint32x4_t;
+constexpr uint32_t SIMD_WIDTH = 4;
+
+inline SimdFloat SimdBroadcast(float f){ return {vdupq_n_f32(f)}; }
+inline SimdFloat SimdLoad(const float* p){ return {vld1q_f32(p)}; }
+inline void SimdStore(float* p,SimdFloat a){ vst1q_f32(p,a.v); }
+inline SimdIndex SimdLoadIndex(const uint32_t* p){ return vld1q_u32(p); }
+//no gather instruction,the lanes are loaded one by one
+inline SimdFloat SimdGather(const float* base,SimdIndex idx){
+    float32x4_t v = vdupq_n_f32(0);
+    v = vld1q_lane_f32(base+vgetq_lane_u32(idx,0),v,0);
+    v = vld1q_lane_f32(base+vgetq_lane_u32(idx,1),v,1);
+    v = vld1q_lane_f32(base+vgetq_lane_u32(idx,2),v,2);
+    v = vld1q_lane_f32(base+vgetq_lane_u32(idx,3),v,3);
+    return {v};
+}
+inline SimdFloat operator+(SimdFloat a,SimdFloat b){ return {vaddq_f32(a.v,b.v)}; }
+inline SimdFloat operator-(SimdFloat a,SimdFloat b){ return {vsubq_f32(a.v,b.v)}; }
+inline SimdFloat operator*(SimdFloat a,SimdFloat b){ return {vmulq_f32(a.v,b.v)}; }
+inline SimdFloat operator/(SimdFloat a,SimdFloat b){ return {vdivq_f32(a.v,b.v)}; }
+inline SimdFloat SimdSqrt(SimdFloat a){ return {vsqrtq_f32(a.v)}; }
+inline SimdMask SimdLess(SimdFloat a,SimdFloat b){ return vcltq_f32(a.v,b.v); }
+inline SimdMask SimdLessEqual(SimdFloat a,SimdFloat b){ return vcleq_f32(a.v,b.v); }
+inline SimdMask SimdAnd(SimdMask a,SimdMask b){ return vandq_u32(a,b); }
+inline SimdFloat SimdSelect(SimdMask m,SimdFloat a,SimdFloat b){ return {vbslq_f32(m,a.v,b.v)}; }
+inline uint32_t SimdMaskBits(SimdMask m){
+    const uint32_t weights[4] = {1,2,4,8};
+    return vaddvq_u32(vandq_u32(m,vld1q_u32(weights)));
+}
+inline SimdMask SimdFirstLanes(uint32_t n){
+    const uint32_t lanes[4] = {0,1,2,3};
+    return vcltq_u32(vld1q_u32(lanes),vdupq_n_u32(n));
+}
+inline float SimdSum(SimdFloat a){ return vaddvq_f32(a.v); }
+
+#else
+
+struct SimdFloat{ float v; };
+using SimdMask = bool;
+using SimdIndex = uint32_t;
+constexpr uint32_t SIMD_WIDTH = 1;
+
+inline SimdFloat SimdBroadcast(float f){ return {f}; }
+inline SimdFloat SimdLoad(const float* p){ return {*p}; }
+inline void SimdStore(float* p,SimdFloat a){ *p = a.v; }
+inline SimdIndex SimdLoadIndex(const uint32_t* p){ return *p; }
+inline SimdFloat SimdGather(const float* base,SimdIndex idx){ return {base[idx]}; }
+inline SimdFloat operator+(SimdFloat a,SimdFloat b){ return {a.v+b.v}; }
+inline SimdFloat operator-(SimdFloat a,SimdFloat b){ return {a.v-b.v}; }
+inline SimdFloat operator*(SimdFloat a,SimdFloat b){ return {a.v*b.v}; }
+inline SimdFloat operator/(SimdFloat a,SimdFloat b){ return {a.v/b.v}; }
+inline SimdFloat SimdSqrt(SimdFloat a){ return {std::sqrt(a.v)}; }
+inline SimdMask SimdLess(SimdFloat a,SimdFloat b){ return a.v<b.v; }
+inline SimdMask SimdLessEqual(SimdFloat a,SimdFloat b){ return a.v<=b.v; }
+inline SimdMask SimdAnd(SimdMask a,SimdMask b){ return a&&b; }
+inline SimdFloat SimdSelect(SimdMask m,SimdFloat a,SimdFloat b){ return m?a:b; }
+inline uint32_t SimdMaskBits(SimdMask m){ return m?1u:0u; }
+inline SimdMask SimdFirstLanes(uint32_t n){ return n>0; }
+inline float SimdSum(SimdFloat a){ return a.v; }
+
+#endif
+
+inline SimdFloat operator*(SimdFloat a,float b){ return a*SimdBroadcast(b); }
+inline SimdFloat operator-(SimdFloat a,float b){ return a-SimdBroadcast(b); }
+inline SimdFloat operator+(SimdFloat a,float b){ return a+SimdBroadcast(b); }
+inline SimdFloat SimdZero(){ return SimdBroadcast(0.0f); }
+inline SimdFloat SimdAbs(SimdFloat a){ return SimdSelect(SimdLess(a,SimdZero()),SimdZero()-a,a); }
+//integer exponents (scorrN is usually 4) stay in the lanes,anything else goes through std::pow lane by lane
+inline SimdFloat SimdPow(SimdFloat a,float n){
+    if(n >= 0 && n <= 16 && n == std::floor(n)){
+        SimdFloat res = SimdBroadcast(1.0f);
+        for(uint32_t e=static_cast<uint32_t>(n);e>0;e>>=1){
+            if(e&1){
+                res = res*a;
+            }
+            a = a*a;
+        }
+        return res;
+    }
+    float lanes[SIMD_WIDTH];
+    SimdStore(lanes,a);
+    for(uint32_t i=0;i<SIMD_WIDTH;++i){
+        lanes[i] = std::pow(lanes[i],n);
+    }
+    return SimdLoad(lanes);
+}
+#endif
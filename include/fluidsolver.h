@@ -0,0 +1,376 @@
+#ifndef FLUIDSOLVER_H
+#define FLUIDSOLVER_H
+#include"vulkan/vulkan.h"
+#include"glm/glm.hpp"
+#include"renderer_types.h"
+#include"gpuprofiler.h"
+
+#include<vector>
+#include<array>
+#include<string>
+#include<cstddef>
+
+//device objects a solver runs on,owned by whoever created the device
+struct FluidSolverContext{
+    VkPhysicalDevice PDevice = VK_NULL_HANDLE;
+    VkDevice LDevice = VK_NULL_HANDLE;
+    //any queue with compute support,the solver submits every step to it
+    VkQueue ComputeQueue = VK_NULL_HANDLE;
+    uint32_t ComputeQueueFamily = 0;
+    //the device was created with pipelineStatisticsQuery,profiling then counts invocations too
+    bool PipelineStatistics = false;
+};
+
+//pbf simulation on its own command pool and descriptor pool,so several solvers can share one device
+//the particle buffers,neighbor search and solver pipelines live here,presentation only reads the particle buffers
+class FluidSolver{
+public:
+    FluidSolver();
+    virtual ~FluidSolver();
+public:
+    void Init(const FluidSolverContext& context);
+    void Cleanup();
+public:
+    void Simulate();
+    void SimulateSteps(uint32_t steps);
+    void WaitIdle();
+public:
+    void SetSimulatingObj(const UniformSimulatingObject& sobj);
+    void SetNSObj(const UniformNSObject& nobj);
+    void SetBoxinfoObj(const UniformBoxInfoObject& bobj);
+    void SetParticles(const std::vector<Particle>& ps);
+    //domains after the first are simulated in the same dispatches but never see each other's particles
+    //SetParticles,SetSimulatingObj and SetBoxinfoObj act on domain 0
+    uint32_t AddDomain(const std::vector<Particle>& ps,const UniformSimulatingObject& sobj,const UniformBoxInfoObject& bobj);
+    void SetDomainSimulatingObj(uint32_t domain,const UniformSimulatingObject& sobj);
+    void SetDomainBoxinfoObj(uint32_t domain,const UniformBoxInfoObject& bobj);
+    //slots the particle buffers are sized for,emitters can fill them up to this many
+    void SetParticleCapacity(uint32_t capacity);
+    uint32_t AddEmitter(const ParticleEmitterObject& emitter);
+    void SetEmitter(uint32_t index,const ParticleEmitterObject& emitter);
+    uint32_t AddSink(const ParticleSinkObject& sink);
+    void SetRadixsortMode(RadixsortMode mode);
+    void SetReorderInterval(uint32_t interval);
+    void SetSolverIterations(uint32_t iterations);
+    void SetSubsteps(uint32_t substeps);
+    void SetParticleLayout(ParticleLayout layout);
+    void SetCompactDomain(glm::vec3 origin,float extent);
+    void SetNeighborMode(NeighborMode mode);
+    void SetFusedSolver(bool fused);
+    void SetCellIndexMode(CellIndexMode mode);
+    //search neighbors out to sphRadius+skin and keep the lists until a particle moved more than skin/2,0 rebuilds every step
+    void SetNeighborSkin(float skin);
+    //bounds of the dense cell grid,left unset it covers every domain's box
+    void SetCellGrid(glm::vec3 origin,glm::vec3 extent);
+    //timestamps around every stage of a step,read through GetProfiler
+    void SetProfiling(bool profiling);
+    void GetParticles(std::vector<Particle>& ps);
+public:
+    //read by the presentation layer
+    bool IsInitialized() const { return Initialized; }
+    uint32_t GetFlightCount() const { return MAXInFlightRendering; }
+    uint32_t GetCurrentFlight() const { return CurrentFlight; }
+    uint32_t GetParticleCapacity() const { return ParticleCapacity; }
+    //reads the live count back,waits for the queue
+    uint32_t GetParticleCount();
+    //neighbor searches actually run since init,every step without a skin,waits for the queue
+    uint32_t GetNeighborRebuildCount();
+    //the live count as a VkDrawIndirectCommand for the fluid pass
+    VkBuffer GetParticleCountBuffer() const { return ParticleCountBuffer; }
+    VkDeviceSize GetParticleDrawOffset() const { return offsetof(ParticleCountObject,liveParticles); }
+    uint32_t GetDomainCount() const { return static_cast<uint32_t>(domainobjs.size()); }
+    static uint32_t GetParticleDomain(const Particle& p) { return p.Id>>DOMAIN_ID_SHIFT; }
+    ParticleLayout GetParticleLayout() const { return particlelayout; }
+    VkBuffer GetParticleBuffer(uint32_t flight) const { return ParticleBuffers[flight]; }
+    VkBuffer GetBoxInfoBuffer() const { return UniformBoxInfoBuffer; }
+    VkSpecializationInfo* GetParticleSpecialization();
+    VkSemaphore TakeSimulatingSemaphore();
+    //stage timings of the steps finished by the last SimulateSteps
+    const GpuProfiler& GetProfiler() const { return Profiler; }
+    //drops the samples taken so far,e.g. those of warm-up steps,call on an idle queue
+    void ResetProfiler() { Profiler.ResetTimings(); }
+    //neighbors within the simulating radius per particle,reduced on the gpu by ngbrtotal.comp,waits for the queue
+    float GetMeanNeighborCount();
+    //estimated bytes every profiled stage of one step asks for,stage names as the profiler records them
+    void GetStageTraffic(uint32_t particles,float neighbors,std::vector<GpuStageTraffic>& traffic);
+    //read plus written bytes per second of a large device local copy in GB/s,0 without timestamps,waits for the queue
+    double MeasureCopyBandwidth();
+    //bytes of every buffer the solver holds,staging buffers included while they live
+    VkDeviceSize GetDeviceMemoryUsage() const { return DeviceMemoryUsage; }
+    VkDeviceSize GetPeakDeviceMemoryUsage() const { return PeakDeviceMemoryUsage; }
+private:
+    void CreateSupportObjects();
+    void CleanupSupportObjects();
+    void CreateCommandPool();
+
+    void CreateParticleBuffer();
+    void CreateParticleNgbrBuffer();
+    VkDeviceSize GetParticleNgbrBufferSize();
+    void CreateNgbrOffsetBuffer();
+    void CreateNgbrInfoBuffer();
+    void CreateSolverPositionBuffer();
+    void RegrowParticleNgbrBuffer();
+    void CreateSkinReferenceBuffer();
+    void ForceNeighborRebuild();
+
+    void CreateUniformSimulatingBuffer();
+    void CreateUniformNSBuffer();
+    void CreateUniformBoxInfoBuffer();
+    void CreateDomainBuffer();
+    void CreateParticleCountBuffer();
+    ParticleCountObject ReadParticleCountObject();
+    void CreateEmitterBuffer();
+    void CreateSinkBuffer();
+
+    void CreateRadixsortedIndexBuffer();
+    void CreateRSGlobalBucketBuffer();
+    void CreateCellinfoBuffer();
+    void RegrowCellBuffers();
+    VkDeviceSize GetCellinfoBufferSize();
+    //grid and hashsize for cells of radius,left untouched when it throws
+    void ComputeCellGrid(float radius);
+    void CreateLocalPrefixBuffer();
+    void CreateSortKeyBuffer();
+    void CreateRSOnesweepBuffer();
+    void CreateReorderBuffer();
+    VkDeviceSize GetParticleBufferSize();
+    void PackParticles(void* dst);
+    void PackSOAParticles(void* dst);
+    void UnpackParticles(const void* src,uint32_t count,std::vector<Particle>& ps);
+    uint32_t GetEmitGroupCount();
+
+    void CreateDescriptorSetLayout();
+    void CreateDescriptorPool();
+    void CreateDescriptorSet();
+    void WriteSimulateNeighborDescriptors();
+
+    void CreateComputePipelineLayout();
+    void CreateComputePipeline();
+    //the pipelines only,the layouts outlive a rebuild with new specialization constants
+    void CleanupComputePipeline();
+
+    void RecordSimulatingCommandBuffers();
+    void RecordReorderCommandBuffers();
+private:
+    bool IsOnesweepSupported(VkPhysicalDevice pdevice);
+    uint32_t GetRadixsortPasses(uint32_t hashsize);
+    uint32_t GetCellScanBlockCount();
+    VkShaderModule MakeShaderModule(const char* filename);
+    std::string GetParticleShaderPath(const char* name);
+
+    VkCommandBuffer CreateCommandBuffer();
+    void SubmitCommandBuffer(VkCommandBuffer& cb,VkSubmitInfo submitinfom,VkFence fence,VkQueue queue);
+
+    void CreateBuffer(VkBuffer& buffer,VkDeviceMemory& memory,VkDeviceSize size,VkBufferUsageFlags usage,VkMemoryPropertyFlags memproperties);
+    uint32_t ChooseMemoryType(uint32_t typefilter,VkMemoryPropertyFlags properties);
+    void CleanupBuffer(VkBuffer& buffer,VkDeviceMemory& memory,bool mapped);
+private:
+    VkPhysicalDevice PDevice;
+    VkDevice LDevice;
+    VkQueue ComputeQueue;
+    uint32_t ComputeQueueFamily;
+
+    VkCommandPool CommandPool;
+    VkDescriptorPool DescriptorPool;
+
+    VkDescriptorSetLayout NSDescriptorSetLayout;
+    std::vector<VkDescriptorSet> NSDescriptorSets[2];
+
+    VkPipelineLayout NSPipelineLayout;
+    VkPipeline NSPipeline_NgbrDisplacement;
+    VkPipeline NSPipeline_NgbrSchedule;
+    VkPipeline NSPipeline_CellClear;
+    VkPipeline NSPipeline_CalcellHash;
+    VkPipeline NSPipeline_Radixsort1;
+    VkPipeline NSPipeline_Radixsort2;
+    VkPipeline NSPipeline_RadixsortBlockScan;
+    VkPipeline NSPipeline_Radixsort3;
+    VkPipeline NSPipeline_RadixsortHistogram;
+    VkPipeline NSPipeline_RadixsortOnesweep;
+    VkPipeline NSPipeline_CellCount;
+    VkPipeline NSPipeline_CellScan;
+    VkPipeline NSPipeline_CellScatter;
+    VkPipeline NSPipeline_FixcellBuffer;
+    VkPipeline NSPipeline_GetNgbrs;
+    VkPipeline NSPipeline_NgbrCount;
+    VkPipeline NSPipeline_NgbrScan;
+    VkPipeline NSPipeline_NgbrBlockScan;
+    VkPipeline NSPipeline_NgbrFill;
+    VkPipeline NSPipeline_Reorder;
+    VkPipeline NSPipeline_ParticleSink;
+    VkPipeline NSPipeline_ParticleSinkScan;
+    VkPipeline NSPipeline_ParticleCompact;
+    VkPipeline NSPipeline_ParticleCopy;
+    VkPipeline NSPipeline_ParticleEmit;
+    VkPipeline NSPipeline_ParticleCount;
+
+    VkDescriptorSetLayout SimulateDescriptorSetLayout;
+    std::vector<VkDescriptorSet> SimulateDescriptorSet;
+    VkPipelineLayout SimulatePipelineLayout;
+    VkPipeline SimulatePipeline_Euler;
+    VkPipeline SimulatePipeline_Lambda;
+    VkPipeline SimulatePipeline_DeltaPosition;
+    VkPipeline SimulatePipeline_PositionUpd;
+    VkPipeline SimulatePipeline_VelocityUpd;
+    VkPipeline SimulatePipeline_VelocityCache;
+    VkPipeline SimulatePipeline_ViscosityCorr;
+    VkPipeline SimulatePipeline_VorticityCorr;
+    VkPipeline SimulatePipeline_Solve;
+    VkPipeline SimulatePipeline_NgbrTotal;
+
+    VkSemaphore SimulatingFinish;
+
+    VkBuffer UniformSimulatingBuffer;
+    VkDeviceMemory UniformSimulatingBufferMemory;
+    void* MappedSimulatingBuffer;
+
+    VkBuffer UniformNSBuffer;
+    VkDeviceMemory UniformNSBufferMemory;
+    void* MappedNSBuffer;
+
+    VkBuffer UniformBoxInfoBuffer;
+    VkDeviceMemory UniformBoxInfoBufferMemory;
+    void* MappedBoxInfoBuffer;
+
+    VkBuffer DomainBuffer;
+    VkDeviceMemory DomainBufferMemory;
+    void* MappedDomainBuffer;
+
+    VkBuffer ParticleCountBuffer;
+    VkDeviceMemory ParticleCountBufferMemory;
+
+    VkBuffer EmitterBuffer;
+    VkDeviceMemory EmitterBufferMemory;
+    void* MappedEmitterBuffer;
+
+    VkBuffer SinkBuffer;
+    VkDeviceMemory SinkBufferMemory;
+    void* MappedSinkBuffer;
+
+    std::vector<VkBuffer> ParticleBuffers;
+    std::vector<VkDeviceMemory> ParticleBufferMemory;
+
+    VkBuffer ParticleNgbrBuffer;
+    VkDeviceMemory ParticleNgbrBufferMemory;
+
+    VkBuffer RadixsortedIndexBuffer[2];
+    VkDeviceMemory RadixsortedIndexBufferMemory[2];
+
+    VkBuffer RSGlobalBucketBuffer;
+    VkDeviceMemory RSGlobalBucketBufferMemory;
+
+    VkBuffer LocalPrefixBuffer;
+    VkDeviceMemory LocalPrefixBufferMemory;
+
+    VkBuffer CellinfoBuffer;
+    VkDeviceMemory CellinfoBufferMemory;
+
+    VkBuffer SortKeyBuffer[2];
+    VkDeviceMemory SortKeyBufferMemory[2];
+
+    VkBuffer RSOnesweepBuffer;
+    VkDeviceMemory RSOnesweepBufferMemory;
+
+    VkBuffer ReorderBuffer;
+    VkDeviceMemory ReorderBufferMemory;
+
+    VkBuffer NgbrOffsetBuffer;
+    VkDeviceMemory NgbrOffsetBufferMemory;
+
+    VkBuffer NgbrInfoBuffer;
+    VkDeviceMemory NgbrInfoBufferMemory;
+    void* MappedNgbrInfoBuffer;
+
+    VkBuffer SolverPositionBuffer;
+    VkDeviceMemory SolverPositionBufferMemory;
+
+    VkBuffer SkinReferenceBuffer;
+    VkDeviceMemory SkinReferenceBufferMemory;
+
+    std::vector<VkCommandBuffer> SimulatingCommandBuffers;
+    std::vector<VkCommandBuffer> ReorderCommandBuffers;
+
+    GpuProfiler Profiler;
+private:
+
+    bool Initialized = false;
+    std::vector<Particle> particles;
+    //0 sizes the buffers for the uploaded particles only
+    uint32_t ParticleCapacity = 0;
+    std::vector<ParticleEmitterObject> emitterobjs;
+    std::vector<ParticleSinkObject> sinkobjs;
+
+    UniformNSObject nsobject{};
+    UniformSimulatingObject simulatingobj{};
+    //one per domain,domain 0 is also the uniform the box is drawn from
+    std::vector<UniformBoxInfoObject> boxinfobjs = std::vector<UniformBoxInfoObject>(1);
+    //the domain table,restDensity and scorr of domain 0 are filled from simulatingobj at init
+    std::vector<FluidDomainObject> domainobjs = std::vector<FluidDomainObject>(1);
+    //uploaded particles per domain,in upload order
+    std::vector<uint32_t> domainsizes = std::vector<uint32_t>(1);
+
+    uint32_t CurrentFlight = 0;
+    //particle buffers the steps ping-pong between,the presentation layer draws the current one
+    uint32_t MAXInFlightRendering = 2;
+
+    uint32_t ONE_GROUP_INVOCATION_COUNT = 512;
+    uint32_t WORK_GROUP_COUNT;
+    //blocks of 512 workgroups the bucket and neighbor count scans run in before the one-workgroup top level
+    uint32_t SCAN_BLOCK_COUNT;
+    //cells the cell table and the counting sort look-back were created for,a larger hashsize regrows them
+    uint32_t CellinfoCapacity = 0;
+    //cellscan.comp covers 4 cells per invocation
+    uint32_t CELL_SCAN_CELLS_PER_BLOCK = 2048;
+
+    uint32_t MAX_NGBR_NUM = 128;
+    uint32_t PARTICLE_SOA_STREAMS = 5;
+    uint32_t PARTICLE_COMPACT_STREAMS = 6;
+
+    ParticleLayout particlelayout = ParticleLayout::AOS;
+    //cube the compact layout quantizes positions into
+    glm::vec3 CompactDomainOrigin = glm::vec3(-1.0f);
+    float CompactDomainExtent = 4.0f;
+    NeighborMode neighbormode = NeighborMode::LIST;
+    //two dispatches per solver iteration instead of three,see resources/shaders/glsl/solver.glsl
+    bool bFusedSolver = false;
+    //see SetNeighborSkin
+    float NeighborSkin = 0.0f;
+    //initial capacity of the packed neighbor list per particle
+    uint32_t NGBR_CAPACITY_PER_PARTICLE = 48;
+    uint32_t NgbrCapacity = 0;
+    CellIndexMode cellindexmode = CellIndexMode::HASH;
+    glm::vec3 CellGridOrigin = glm::vec3(0.0f);
+    glm::vec3 CellGridExtent = glm::vec3(0.0f);
+    //first cell and cell count per axis of the dense grid,in units of sphRadius
+    glm::ivec3 CellGridMin = glm::ivec3(0);
+    glm::uvec3 CellGridDim = glm::uvec3(1);
+    struct{
+        float DomainOrigin[3];
+        float DomainExtent;
+        uint32_t NeighborMode;
+        VkBool32 FusedSolver;
+        uint32_t CellIndexMode;
+        int32_t CellGridMin[3];
+        uint32_t CellGridDim[3];
+    } ParticleSpecializationData;
+    std::array<VkSpecializationMapEntry,13> ParticleSpecializationEntries;
+    VkSpecializationInfo ParticleSpecializationInfo;
+    RadixsortMode radixsortmode = RadixsortMode::AUTO;
+    uint32_t RADIX_SORT_BITS;
+    uint32_t RADIX_SORT_PASSES;
+    uint32_t ONESWEEP_TICKET_OFFSET = 1024;
+    uint32_t ONESWEEP_STATUS_OFFSET = 1028;
+
+    //permute the particle buffer into cell order every ReorderInterval steps,0 disables it
+    uint32_t ReorderInterval = 0;
+    uint32_t SimulatedSteps = 0;
+    uint32_t SolverIterations = 3;
+    //simulating steps per Simulate() call,each advancing dt/Substeps
+    uint32_t Substeps = 1;
+    //SimulatingFinish has been signaled and nobody waited on it yet
+    bool bSimulatingSignaled = false;
+    bool bProfiling = false;
+    VkDeviceSize DeviceMemoryUsage = 0;
+    VkDeviceSize PeakDeviceMemoryUsage = 0;
+};
+#endif
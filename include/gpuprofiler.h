@@ -0,0 +1,117 @@
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+#include"vulkan/vulkan.h"
+
+#include<vector>
+#include<string>
+#include<unordered_map>
+#include<ostream>
+#include<cstdint>
+
+//time one stage took on the gpu,in milliseconds
+struct GpuStageTiming{
+    std::string name;
+    //over the last GpuProfiler::WINDOW samples
+    double average = 0;
+    double last = 0;
+    uint64_t samples = 0;
+    //of the last sample,only with pipeline statistics
+    uint64_t vertexinvocations = 0;
+    uint64_t fragmentinvocations = 0;
+    uint64_t computeinvocations = 0;
+};
+//bytes one run of a stage asks for,estimated from the sizes and counts it works on
+//gathers of neighbor fields count in full,caches are not modeled
+struct GpuStageTraffic{
+    std::string name;
+    double bytesread = 0;
+    double byteswritten = 0;
+};
+//timing,invocations and traffic of a stage side by side
+struct GpuStageStats{
+    std::string source;
+    GpuStageTiming timing;
+    double bytesread = 0;
+    double byteswritten = 0;
+    //requested bytes over the average time in GB/s,gathers served by the caches can push it past the device peak
+    double bandwidth = 0;
+};
+
+//timestamps between the stages of prerecorded command buffers
+//every command buffer variant (a slot,e.g. one flight) owns a query pool it resets as its first command,
+//results are read back once a later Collect finds all of them available,so nothing ever waits on the gpu
+//a slot replayed several times in one submission keeps the timings of its last replay
+//stages are keyed by name,slots recording the same stages feed the same averages
+class GpuProfiler{
+public:
+    //leaves the profiler disabled when the queue family has no timestamps,every other call is then a no-op
+    //pipelinestatistics needs the device created with pipelineStatisticsQuery,every stage then also counts its shader invocations
+    void Init(VkPhysicalDevice pdevice,VkDevice ldevice,uint32_t queuefamily,uint32_t slots,bool pipelinestatistics = false);
+    void Cleanup();
+    //queries of a new pool can not be read before a reset,record into a one-time command buffer after Init
+    void RecordReset(VkCommandBuffer cb);
+    bool IsEnabled() const { return bEnabled; }
+    bool HasPipelineStatistics() const { return bPipelineStatistics; }
+public:
+    //first command of the slot's command buffer,forgets the stages it recorded before
+    void BeginSlot(VkCommandBuffer cb,uint32_t slot);
+    //ends the running stage of the slot and starts name
+    void MarkStage(VkCommandBuffer cb,uint32_t slot,const std::string& name);
+    //ends the running stage,last command before vkEndCommandBuffer
+    void EndSlot(VkCommandBuffer cb,uint32_t slot);
+    //the slot went into a submission,its queries are read once they all landed
+    void MarkSubmitted(uint32_t slot);
+    //takes the results of every submitted slot that completed since the last call
+    void Collect();
+public:
+    //in the order the stages were first recorded
+    void GetTimings(std::vector<GpuStageTiming>& timings) const;
+    void ResetTimings();
+    //one row per stage,source names the profiler in the first column
+    void WriteCSV(std::ostream& out,const char* source) const;
+    //array of {name,average_ms,last_ms,samples,invocations}
+    void WriteJSON(std::ostream& out) const;
+public:
+    static constexpr uint32_t WINDOW = 128;
+    //stages past this many in one slot run into the last one
+    static constexpr uint32_t MAX_SLOT_QUERIES = 256;
+private:
+    uint32_t GetStageIndex(const std::string& name);
+    void WriteTimestamp(VkCommandBuffer cb,uint32_t slot);
+
+    struct Slot{
+        VkQueryPool pool = VK_NULL_HANDLE;
+        //one pipeline statistics query per stage,VK_NULL_HANDLE without them
+        VkQueryPool statisticspool = VK_NULL_HANDLE;
+        //stage of every recorded interval,interval k lies between query k and k+1
+        std::vector<uint32_t> stages;
+        uint32_t queries = 0;
+        bool bSubmitted = false;
+        //first timestamp of the results collected last,a replay not started yet still shows them
+        uint64_t lastbegin = 0;
+    };
+    struct Stage{
+        std::string name;
+        std::vector<double> window;
+        uint32_t next = 0;
+        uint64_t samples = 0;
+        double last = 0;
+        uint64_t invocations[3] = {0,0,0};
+    };
+
+    VkDevice LDevice = VK_NULL_HANDLE;
+    std::vector<Slot> slots;
+    std::vector<Stage> stages;
+    std::unordered_map<std::string,uint32_t> stageindices;
+    std::vector<uint64_t> results;
+    std::vector<uint64_t> statistics;
+    //nanoseconds per tick
+    double TimestampPeriod = 1.0;
+    uint64_t TimestampMask = ~0ull;
+    bool bEnabled = false;
+    bool bPipelineStatistics = false;
+    //vertex and fragment invocations only on graphics queues,results come in bit order
+    VkQueryPipelineStatisticFlags StatisticsFlags = 0;
+    uint32_t StatisticsCount = 0;
+};
+#endif
@@ -2,8 +2,11 @@
 #define HELPERFUNCS_H
 #include<fstream>
 #include<vector>
+#include<cstdint>
 class HelperFuncs{
 public:
     static void ReadFile(const char* filename,std::vector<char>& bytes);
+    static uint16_t FloatToHalf(float value);
+    static float HalfToFloat(uint16_t value);
 };
 #endif
\ No newline at end of file
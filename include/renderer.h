@@ -6,12 +6,26 @@
 #include"GLFW/glfw3.h"
 #include"glm/glm.hpp"
 #include"renderer_types.h"
+#include"fluidsolver.h"
 
 #include<vector>
 #include<array>
 #include<optional>
 #include<string>
 
+//what Renderer::GetStats reports
+struct RendererStats{
+    //simulation stages first,then rendering
+    std::vector<GpuStageStats> stages;
+    uint32_t particles = 0;
+    //mean neighbors within the search radius
+    float neighbors = 0;
+    //of a device local copy,read plus written,GB/s,0 when it could not be timed
+    double peakbandwidth = 0;
+    //the invocation counts of the stages are filled in
+    bool pipelinestatistics = false;
+};
+
 class Renderer{
 public:
     Renderer(uint32_t w,uint32_t h,bool validation = false);
@@ -21,7 +35,13 @@ public:
     void Init();
     void Cleanup();
 public:
-    void Simulate();
+    FluidSolver& GetSolver(){ return Solver; }
+    //stage timings of the fluid passes,the solver has its own
+    const GpuProfiler& GetProfiler() const { return Profiler; }
+    //both profilers,json when path ends in .json,csv otherwise
+    void WriteGpuTimings(const std::string& path);
+    //stage timings with invocation counts and estimated bandwidth,needs SetStatistics,waits for the device
+    void GetStats(RendererStats& stats);
     void BoxRender(uint32_t dstimage);
     void FluidsRender(uint32_t dstimage);
     void Draw();
@@ -38,18 +58,9 @@ private:
     void CleanupSupportObjects();
     void CreateCommandPool();
 
-    void CreateParticleBuffer();
-    void CreateParticleNgbrBuffer();
 
     void CreateUniformRenderingBuffer();
-    void CreateUniformSimulatingBuffer();
-    void CreateUniformNSBuffer();
-    void CreateUniformBoxInfoBuffer();
 
-    void CreateRadixsortedIndexBuffer();
-    void CreateRSGlobalBucketBuffer();
-    void CreateCellinfoBuffer();
-    void CreateLocalPrefixBuffer();
 
     void CreateDepthResources();
     void CreateThickResources();
@@ -58,6 +69,7 @@ private:
 
     void CreateSwapChain();
     void CleanupSwapChain();
+    void CleanupGraphicObjects();
     void RecreateSwapChain();
 
     void CreateDescriptorSetLayout();
@@ -74,7 +86,6 @@ private:
 
     void CreateFramebuffers();
 
-    void RecordSimulatingCommandBuffers();
     void RecordFluidsRenderingCommandBuffers();
     void RecordBoxRenderingCommandBuffers();
 
@@ -127,18 +138,6 @@ private:
 
     VkDescriptorPool DescriptorPool;
 
-    VkDescriptorSetLayout NSDescriptorSetLayout;
-   
-    std::vector<VkDescriptorSet> NSDescriptorSets[2];
-
-    VkPipelineLayout NSPipelineLayout;
-    VkPipeline NSPipeline_CalcellHash;
-    VkPipeline NSPipeline_Radixsort1;
-    VkPipeline NSPipeline_Radixsort2;
-    VkPipeline NSPipeline_Radixsort3;
-    VkPipeline NSPipeline_FixcellBuffer;
-    VkPipeline NSPipeline_GetNgbrs;
-
     VkRenderPass FluidGraphicRenderPass;
     VkDescriptorSetLayout FluidGraphicDescriptorSetLayout;
     VkDescriptorSet FluidGraphicDescriptorSet;
@@ -151,18 +150,6 @@ private:
     VkPipelineLayout BoxGraphicPipelineLayout;
     VkPipeline BoxGraphicPipeline;
 
-    VkDescriptorSetLayout SimulateDescriptorSetLayout;
-    std::vector<VkDescriptorSet> SimulateDescriptorSet;
-    VkPipelineLayout SimulatePipelineLayout;
-    VkPipeline SimulatePipeline_Euler;
-    VkPipeline SimulatePipeline_Lambda;
-    VkPipeline SimulatePipeline_DeltaPosition;
-    VkPipeline SimulatePipeline_PositionUpd;
-    VkPipeline SimulatePipeline_VelocityUpd;
-    VkPipeline SimulatePipeline_VelocityCache;
-    VkPipeline SimulatePipeline_ViscosityCorr;
-    VkPipeline SimulatePipeline_VorticityCorr;
-
     VkDescriptorSetLayout FilterDecsriptorSetLayout;
     VkDescriptorSet FilterDescriptorSet;
     VkPipelineLayout FilterPipelineLayout;
@@ -177,23 +164,11 @@ private:
     VkSemaphore ImageAvaliable;
     VkSemaphore FluidsRenderingFinish;
     VkSemaphore BoxRenderingFinish;
-    VkSemaphore SimulatingFinish;
 
     VkBuffer UniformRenderingBuffer;
     VkDeviceMemory UniformRenderingBufferMemory;
     void* MappedRenderingBuffer;
 
-    VkBuffer UniformSimulatingBuffer;
-    VkDeviceMemory UniformSimulatingBufferMemory;
-    void* MappedSimulatingBuffer;
-
-    VkBuffer UniformNSBuffer;
-    VkDeviceMemory UniformNSBufferMemory;
-    void* MappedNSBuffer;
-
-    VkBuffer UniformBoxInfoBuffer;
-    VkDeviceMemory UniformBoxInfoBufferMemory;
-    void* MappedBoxInfoBuffer;
 
 
     VkImage ThickImage;
@@ -228,56 +203,44 @@ private:
     VkFramebuffer FluidsFramebuffer;
     VkFramebuffer BoxFramebuffer;
 
-    std::vector<VkBuffer> ParticleBuffers;
-    std::vector<VkDeviceMemory> ParticleBufferMemory;
-
-    VkBuffer ParticleNgbrBuffer;
-    VkDeviceMemory ParticleNgbrBufferMemory;
-
-    VkBuffer RadixsortedIndexBuffer[2];
-    VkDeviceMemory RadixsortedIndexBufferMemory[2];
-
-    VkBuffer RSGlobalBucketBuffer;
-    VkDeviceMemory RSGlobalBucketBufferMemory;
-
-    VkBuffer LocalPrefixBuffer;
-    VkDeviceMemory LocalPrefixBufferMemory;
-
-    VkBuffer CellinfoBuffer;
-    VkDeviceMemory CellinfoBufferMemory;
-
     VkBuffer BoxVertexBuffer;
     VkDeviceMemory BoxVertexBufferMemory;
 
-    std::vector<VkCommandBuffer> SimulatingCommandBuffers;
     std::vector<VkCommandBuffer> FluidsRenderingCommandBuffers[2];
     VkCommandBuffer BoxRenderingCommandBuffer;
+
+    GpuProfiler Profiler;
 public:
     void SetRenderingObj(const UniformRenderingObject& robj);
-    void SetSimulatingObj(const UniformSimulatingObject& sobj);
-    void SetNSObj(const UniformNSObject& nobj);
-    void SetBoxinfoObj(const UniformBoxInfoObject& bobj);
-    void SetParticles(const std::vector<Particle>& ps);
+    void SetHeadless(bool headless);
+    //also turns on the solver's,see FluidSolver::SetProfiling
+    void SetProfiling(bool profiling);
+    //profiling plus pipeline statistics where the device has them,see GetStats
+    void SetStatistics(bool statistics);
+    //only devices whose name contains name are considered,e.g. "llvmpipe" for the software rasterizer
+    void SetPreferredDevice(const std::string& name);
+    VkPhysicalDeviceProperties GetDeviceProperties();
 private:
     
     bool Initialized = false;
     uint32_t Width;
     uint32_t Height;
-    std::vector<Particle> particles;
 
-    UniformNSObject nsobject{};
     UniformRenderingObject renderingobj{};
-    UniformSimulatingObject simulatingobj{};
-    UniformBoxInfoObject boxinfobj{};
 
     bool bEnableValidation = false;
-    uint32_t CurrentFlight = 0;
-    uint32_t MAXInFlightRendering = 2;
-
-    uint32_t ONE_GROUP_INVOCATION_COUNT = 512;
-    uint32_t WORK_GROUP_COUNT;
-
-    uint32_t MAX_NGBR_NUM = 128;
+    //compute only,no window,surface,swapchain or graphic objects
+    bool bHeadless = false;
     bool bFramebufferResized = false;
+    bool bProfiling = false;
+    bool bStatistics = false;
+    //the device was created with pipelineStatisticsQuery
+    bool bPipelineStatistics = false;
+    //of MeasureCopyBandwidth,taken on the first GetStats
+    double PeakBandwidth = 0;
+    std::string PreferredDevice;
+
+    //owns the particles and every simulating object,the renderer only draws its particle buffers
+    FluidSolver Solver;
 };
 #endif
\ No newline at end of file
@@ -25,6 +25,27 @@ enum class TickWindowResult{
     HIDE,
     EXIT,
 };
+enum class RadixsortMode{
+    AUTO,
+    BLELLOCH,//4-bit digits,shared memory scan,works everywhere
+    ONESWEEP,//8-bit digits,subgroup ranking and decoupled look-back,needs subgroup ballot/arithmetic
+    COUNTING,//one counting sort over the cells,count/scan/scatter instead of key digit passes
+};
+enum class ParticleLayout{
+    AOS,//one 96-byte Particle per element
+    SOA,//vec4 streams,see resources/shaders/glsl/particle.glsl
+    COMPACT,//48 bytes,fixed point position and fp16 attributes,math stays fp32
+};
+enum class NeighborMode{
+    LIST,//getngbrs.comp stores up to 128 neighbors per particle
+    CELLWALK,//constraint kernels walk the 27 sorted cells directly,no list and no cap
+    COMPACTLIST,//count,scan and fill into a packed list sized to the actual total,regrown on overflow
+};
+enum class CellIndexMode{
+    HASH,//spatial hash of the cell,works for unbounded scenes
+    DENSE,//cells linearized inside the grid around the boxes,no collisions
+    MORTON,//same grid in Morton order,padded to a power of two cube
+};
 struct Particle{
     alignas(16) glm::vec3 Location;
     alignas(16) glm::vec3 Velocity;
@@ -39,20 +60,31 @@ struct Particle{
     alignas(4) uint32_t TmpCellHash;
 
     alignas(4) uint32_t NumNgbrs;
+    alignas(4) uint32_t Id;
 
-    static VkVertexInputBindingDescription GetBinding(){
+    static VkVertexInputBindingDescription GetBinding(ParticleLayout layout = ParticleLayout::AOS){
         VkVertexInputBindingDescription binding{};
         binding.binding = 0;
         binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        binding.stride = sizeof(Particle);
+        //the soa and compact position streams come first
+        switch(layout){
+            case ParticleLayout::SOA: binding.stride = sizeof(glm::vec4); break;
+            case ParticleLayout::COMPACT: binding.stride = 2*sizeof(uint32_t); break;
+            default: binding.stride = sizeof(Particle); break;
+        }
         return binding;
     } 
-    static std::array<VkVertexInputAttributeDescription,1> GetAttributes(){
+    static std::array<VkVertexInputAttributeDescription,1> GetAttributes(ParticleLayout layout = ParticleLayout::AOS){
         std::array<VkVertexInputAttributeDescription,1> attributes;
         attributes[0].binding = 0;
         attributes[0].location = 0;
         attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
         attributes[0].offset = offsetof(Particle,Location);
+        if(layout == ParticleLayout::COMPACT){
+            //fixed point,decoded in the vertex shader
+            attributes[0].format = VK_FORMAT_R32G32_UINT;
+            attributes[0].offset = 0;
+        }
         return attributes;
     }
 };
@@ -91,6 +123,10 @@ struct UniformNSObject{
     alignas(4) uint32_t hashsize;
 
     alignas(4) float sphRadius;
+    //capacity of the packed neighbor list,managed by the solver
+    alignas(4) uint32_t ngbrcapacity;
+    //see FluidSolver::SetNeighborSkin,sphRadius above already includes it,managed by the solver
+    alignas(4) float skin;
 };
 struct UniformBoxInfoObject{
     alignas(8) glm::vec2 clampX;
@@ -101,4 +137,65 @@ struct UniformBoxInfoObject{
     alignas(8) glm::vec2 clampY_still;
     alignas(8) glm::vec2 clampZ_still; 
 };
+//one entry of the domain table,the material of the domain
+//dt and the kernel radius are shared through UniformSimulatingObject
+struct FluidDomainObject{
+    alignas(4) float restDensity;
+    alignas(4) float scorrK;
+    alignas(4) float scorrN;
+    alignas(4) float scorrQ;
+};
+//the id layout of the gpu and host solvers,mirrored in resources/shaders/glsl/domain.glsl
+//size of the box and domain arrays in the shaders
+inline constexpr uint32_t MAX_FLUID_DOMAINS = 16;
+//particle ids carry their domain in the bits above this
+inline constexpr uint32_t DOMAIN_ID_SHIFT = 24;
+//ids keep the upload index below the domain bits,the scans would reach 512*512*512
+inline constexpr uint32_t MAX_PARTICLES = 1u<<DOMAIN_ID_SHIFT;
+//pours a layer of side*side particles,spacing apart across velocity,every interval steps
+struct ParticleEmitterObject{
+    alignas(16) glm::vec3 origin;
+    alignas(4) float spacing;
+    alignas(16) glm::vec3 velocity;
+    alignas(4) uint32_t side;
+    alignas(4) uint32_t interval;
+    alignas(4) uint32_t domain;
+    alignas(4) float mass;
+};
+//removes every particle inside the box at the start of a step
+struct ParticleSinkObject{
+    alignas(16) glm::vec3 boxMin;
+    alignas(16) glm::vec3 boxMax;
+};
+//live particle count,written on the gpu only,see resources/shaders/glsl/count.glsl
+struct ParticleCountObject{
+    //VkDispatchIndirectCommand of every per-particle kernel
+    alignas(4) uint32_t groupCountX;
+    alignas(4) uint32_t groupCountY;
+    alignas(4) uint32_t groupCountZ;
+    //VkDrawIndirectCommand of the fluid pass,vertexCount is the live count
+    alignas(4) uint32_t liveParticles;
+    alignas(4) uint32_t instanceCount;
+    alignas(4) uint32_t firstVertex;
+    alignas(4) uint32_t firstInstance;
+    //survivors of the emit/sink pass,serial of the next emitted particle and steps taken
+    alignas(4) uint32_t keptParticles;
+    alignas(4) uint32_t nextSerial;
+    alignas(4) uint32_t stepCount;
+    //neighbor search skin,see resources/shaders/glsl/ngbrschedule.comp
+    //largest displacement since the last build as float bits,nonzero forces the next build,builds so far
+    alignas(4) uint32_t maxDisplacement;
+    alignas(4) uint32_t forceRebuild;
+    alignas(4) uint32_t rebuildCount;
+    //VkDispatchIndirectCommands of the neighbor search,zero groups on the steps the last lists are kept
+    alignas(4) uint32_t rebuildParticleGroups[3];
+    alignas(4) uint32_t rebuildScanGroups[3];
+    alignas(4) uint32_t rebuildSingleGroup[3];
+    alignas(4) uint32_t rebuildCellScanGroups[3];
+    alignas(4) uint32_t rebuildCellGroups[3];
+    //VkDispatchIndirectCommand of the sink compaction,zero groups on the steps nothing was sunk
+    alignas(4) uint32_t compactGroups[3];
+    //neighbors inside the simulating radius summed by ngbrtotal.comp,only written on demand
+    alignas(4) uint32_t ngbrTotal;
+};
 #endif
\ No newline at end of file
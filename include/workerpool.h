@@ -0,0 +1,40 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+#include<vector>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<atomic>
+#include<functional>
+#include<cstdint>
+
+//persistent threads running one parallel loop at a time
+//blocks are claimed one by one from a shared cursor,so a thread done early keeps taking the blocks left
+class WorkerPool{
+public:
+    //0 uses every hardware thread,the calling thread is one of them
+    explicit WorkerPool(uint32_t threads = 0);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+public:
+    //calls fn(block,thread) once for every block in [0,blocks),returns when every call returned
+    void Run(uint32_t blocks,const std::function<void(uint32_t,uint32_t)>& fn);
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(workers.size())+1; }
+private:
+    void WorkerLoop(uint32_t thread);
+    void RunBlocks(uint32_t thread);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(uint32_t,uint32_t)>* job = nullptr;
+    std::atomic<uint32_t> cursor{0};
+    uint32_t blockcount = 0;
+    //bumped for every Run,a worker only joins a loop it has not seen yet
+    uint64_t generation = 0;
+    uint32_t busy = 0;
+    bool stop = false;
+};
+#endif
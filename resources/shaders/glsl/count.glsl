@@ -0,0 +1,36 @@
+//live particle count,see ParticleCountObject on the host
+//particles fill slots [0,liveParticles) of the buffers,numParticles is the capacity and the stream stride
+//per-particle kernels are dispatched indirectly from groupCountX,see particlecount.comp
+//the neighborhood searcher set binds the count at 15,define COUNT_BINDING before the include there
+
+#ifndef COUNT_GLSL
+#define COUNT_GLSL
+
+#ifndef COUNT_BINDING
+#define COUNT_BINDING 11
+#endif
+
+layout(binding=COUNT_BINDING) buffer ParticleCountBuffer{
+    uint groupCountX;
+    uint groupCountY;
+    uint groupCountZ;
+    uint liveParticles;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    uint keptParticles;
+    uint nextSerial;
+    uint stepCount;
+    uint maxDisplacement;
+    uint forceRebuild;
+    uint rebuildCount;
+    uint rebuildParticleGroups[3];
+    uint rebuildScanGroups[3];
+    uint rebuildSingleGroup[3];
+    uint rebuildCellScanGroups[3];
+    uint rebuildCellGroups[3];
+    uint compactGroups[3];
+    uint ngbrTotal;
+};
+
+#endif
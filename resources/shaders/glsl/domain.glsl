@@ -0,0 +1,88 @@
+//fluid domains batched into one solver,see FluidSolver::AddDomain
+//the domain of a particle is kept in the top bits of its id,so it survives reordering,emission and sinks
+//the neighborhood searcher set binds the table at 14,define DOMAIN_BINDING before the include there
+
+#ifndef DOMAIN_GLSL
+#define DOMAIN_GLSL
+
+#ifndef DOMAIN_BINDING
+#define DOMAIN_BINDING 10
+#endif
+
+//size of the box array,MAX_FLUID_DOMAINS in include/renderer_types.h
+#define MAX_FLUID_DOMAINS 16
+//DOMAIN_ID_SHIFT in include/renderer_types.h
+#define DOMAIN_ID_SHIFT 24
+
+struct FluidDomain{
+    float restDensity;
+    float scorrK;
+    float scorrN;
+    float scorrQ;
+};
+
+layout(binding=DOMAIN_BINDING) readonly buffer DomainBuffer{
+    FluidDomain domains[];
+};
+
+//cellIndexMode follows CellIndexMode on the host:
+//  0: cells are hashed into hashsize buckets,for scenes without bounds
+//  1: cells are linearized inside the grid,z fastest so the cells of a column sit next to each other
+//  2: same grid,Morton ordered inside a power of two cube
+//grid cells are counted from cellGridMin,the host makes hashsize the grid size times the domain count
+layout(constant_id=6) const uint cellIndexMode = 0;
+layout(constant_id=7) const int cellGridMinX = 0;
+layout(constant_id=8) const int cellGridMinY = 0;
+layout(constant_id=9) const int cellGridMinZ = 0;
+layout(constant_id=10) const uint cellGridDimX = 1;
+layout(constant_id=11) const uint cellGridDimY = 1;
+layout(constant_id=12) const uint cellGridDimZ = 1;
+const bool denseGrid = cellIndexMode != 0;
+const bool mortonGrid = cellIndexMode == 2;
+
+uint domain_of(uint id){
+    return id>>DOMAIN_ID_SHIFT;
+}
+
+//cell of a particle,particles that left the grid share the border cells
+ivec3 domain_cell(vec3 location,float radius){
+    ivec3 c = ivec3(floor(location/radius));
+    if(!denseGrid){
+        return c;
+    }
+    ivec3 gridmin = ivec3(cellGridMinX,cellGridMinY,cellGridMinZ);
+    ivec3 griddim = ivec3(cellGridDimX,cellGridDimY,cellGridDimZ);
+    return clamp(c-gridmin,ivec3(0),griddim-1)+gridmin;
+}
+
+//neighbor cells outside the grid hold nothing,clamping them would visit a border cell twice
+bool domain_cellvalid(ivec3 c){
+    if(!denseGrid){
+        return true;
+    }
+    ivec3 g = c-ivec3(cellGridMinX,cellGridMinY,cellGridMinZ);
+    return all(greaterThanEqual(g,ivec3(0))) && all(lessThan(g,ivec3(cellGridDimX,cellGridDimY,cellGridDimZ)));
+}
+
+uint domain_morton_spread(uint v){
+    v = (v|(v<<16))&0x030000FFu;
+    v = (v|(v<<8))&0x0300F00Fu;
+    v = (v|(v<<4))&0x030C30C3u;
+    v = (v|(v<<2))&0x09249249u;
+    return v;
+}
+
+//every domain owns its own slice of the table,so cells of different domains never share a bucket
+uint domain_cellhash(ivec3 c,uint d,uint hashsize){
+    uint span = hashsize/uint(domains.length());
+    if(!denseGrid){
+        return d*span + (uint((73856093*c.x)^(19349663*c.y)^(83492791*c.z)))%span;
+    }
+    uvec3 g = uvec3(c-ivec3(cellGridMinX,cellGridMinY,cellGridMinZ));
+    if(mortonGrid){
+        return d*span + ((domain_morton_spread(g.x)<<2)|(domain_morton_spread(g.y)<<1)|domain_morton_spread(g.z));
+    }
+    return d*span + (g.x*cellGridDimY+g.y)*cellGridDimZ+g.z;
+}
+
+#endif
@@ -0,0 +1,24 @@
+//emitter table of the emit/sink pass,see ParticleEmitterObject on the host
+//include count.glsl first,an emitter fires on the steps stepCount is a multiple of its interval
+
+#ifndef EMITTER_GLSL
+#define EMITTER_GLSL
+
+struct ParticleEmitter{
+    vec3 origin;
+    float spacing;
+    vec3 velocity;
+    uint side;
+    uint interval;
+    uint domain;
+    float mass;
+};
+layout(binding=16) readonly buffer EmitterBuffer{
+    ParticleEmitter emitters[];
+};
+
+bool emitter_due(ParticleEmitter emitter){
+    return emitter.interval != 0 && stepCount%emitter.interval == 0;
+}
+
+#endif
@@ -1,5 +1,12 @@
 #version 450
+#ifdef PARTICLE_COMPACT
+#extension GL_GOOGLE_include_directive : require
+#include "particle.glsl"
+//fixed point position stream,decoded with the same domain as the compute shaders
+layout(location=0) in uvec2 inpackedlocation;
+#else
 layout(location=0) in vec3 inlocation;
+#endif
 
 layout(location=0) flat out float outviewdepth;
 
@@ -18,6 +25,9 @@ layout(binding=0) uniform UniformRenderingObject{
 };
 
 void main(){
+#ifdef PARTICLE_COMPACT
+    vec3 inlocation = p_unpacklocation(inpackedlocation);
+#endif
     vec4 viewlocation = view*model*vec4(inlocation,1); 
     
     outviewdepth = viewlocation.z;
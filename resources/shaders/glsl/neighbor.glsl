@@ -0,0 +1,65 @@
+//neighbor iteration shared by the constraint kernels
+//include after SimulateObj,particlesOut and particleNgbrs are declared
+//neighborMode follows NeighborMode on the host:
+//  0: the fixed 128-slot list built by getngbrs.comp
+//  1: the 27 sorted cells around the particle are walked directly and no list is stored
+//  2: the packed list built by ngbrcount/ngbrscan/ngbrfill.comp,starting at ngbroffset[self]
+
+layout(constant_id=4) const uint neighborMode = 0;
+const bool cellWalk = neighborMode == 1;
+const bool compactList = neighborMode == 2;
+
+layout(binding=5) readonly buffer CellinfoBuffer{
+    uint cellinfo[];
+};
+layout(binding=6) readonly buffer SortedIndexbuffer{
+    uint sortedindex[];
+};
+layout(binding=7) uniform UniformNSObject{
+    uint numParticles;
+    uint workgroup_count;
+    uint hashsize;
+    float sphRadius;
+} nsobj;
+layout(binding=8) readonly buffer NgbrOffsetBuffer{
+    uint ngbroffset[];
+};
+#include "domain.glsl"
+
+#define MAX_NGBR_NUM 128
+
+//where the cell walk reads neighbor positions,kernels may point it elsewhere before the include
+#ifndef NGBR_LOCATION
+#define NGBR_LOCATION(i) P_LOCATION(particlesOut,i)
+#endif
+
+//range of the neighbor list,or of the sorted slots of one of the 27 cells
+uvec2 ngbr_cellrange(uint self,vec3 location,uint domain,uint cell){
+    if(compactList){
+        uint offset = ngbroffset[self];
+        return uvec2(offset,offset+P_NUMNGBRS(particlesOut,self));
+    }
+    if(!cellWalk){
+        return uvec2(0,P_NUMNGBRS(particlesOut,self));
+    }
+    ivec3 c = domain_cell(location,nsobj.sphRadius) + ivec3(cell/9,(cell/3)%3,cell%3) - ivec3(1);
+    if(!domain_cellvalid(c)){
+        return uvec2(0);
+    }
+    uint hashvalue = domain_cellhash(c,domain,nsobj.hashsize);
+    return uvec2(cellinfo[2*hashvalue],cellinfo[2*hashvalue+1]);
+}
+
+//same acceptance test as getngbrs.comp
+#define NGBR_LOOP_BEGIN(self,location,ngbr) \
+    { \
+    uint ngbr_domain = cellWalk?domain_of(P_ID(particlesOut,self)):0u; \
+    for(uint ngbr_cell=0;ngbr_cell<(cellWalk?27u:1u);++ngbr_cell){ \
+        uvec2 ngbr_range = ngbr_cellrange(self,location,ngbr_domain,ngbr_cell); \
+        for(uint ngbr_idx=ngbr_range.x;ngbr_idx!=ngbr_range.y;++ngbr_idx){ \
+            uint ngbr = cellWalk?sortedindex[ngbr_idx]:particleNgbrs[compactList?ngbr_idx:MAX_NGBR_NUM*(self)+ngbr_idx]; \
+            if(cellWalk&&(ngbr==(self)||length(NGBR_LOCATION(ngbr)-(location))>=nsobj.sphRadius)){ \
+                continue; \
+            }
+
+#define NGBR_LOOP_END }}}
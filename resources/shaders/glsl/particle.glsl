@@ -0,0 +1,166 @@
+//particle storage shared by every compute shader
+//compiled once per layout,PARTICLE_SOA or PARTICLE_COMPACT select the other variants
+//fields are only read through P_<FIELD> and written through P_SET_<FIELD>,so kernels read the same for every layout
+
+#if defined(PARTICLE_SOA)
+
+//one buffer split into vec4 streams of numParticles elements each
+//stream 0 is the only one the vertex shader reads
+//  0: Location,Mass
+//  1: Velocity,Density
+//  2: DeltaLocation,Lambda
+//  3: TmpVelocity
+//  4: CellHash,TmpCellHash,NumNgbrs,Id (read through the uvec4 alias)
+#define PARTICLE_STREAM_COUNT 5
+
+#define PARTICLE_ARRAY(name) vec4 name[];
+#define PARTICLE_BITS(bindingidx,blockname,name) layout(binding=bindingidx) buffer blockname##Bits{ uvec4 name##_bits[]; };
+
+#define P_LOCATION(buf,i) buf[(i)].xyz
+#define P_MASS(buf,i) buf[(i)].w
+#define P_VELOCITY(buf,i) buf[numParticles+(i)].xyz
+#define P_DENSITY(buf,i) buf[numParticles+(i)].w
+#define P_DELTALOCATION(buf,i) buf[2*numParticles+(i)].xyz
+#define P_LAMBDA(buf,i) buf[2*numParticles+(i)].w
+#define P_TMPVELOCITY(buf,i) buf[3*numParticles+(i)].xyz
+#define P_CELLHASH(buf,i) buf##_bits[4*numParticles+(i)].x
+#define P_TMPCELLHASH(buf,i) buf##_bits[4*numParticles+(i)].y
+#define P_NUMNGBRS(buf,i) buf##_bits[4*numParticles+(i)].z
+#define P_ID(buf,i) buf##_bits[4*numParticles+(i)].w
+
+#define P_COPY(dst,di,src,si) \
+    dst[(di)] = src[(si)]; \
+    dst[numParticles+(di)] = src[numParticles+(si)]; \
+    dst[2*numParticles+(di)] = src[2*numParticles+(si)]; \
+    dst[3*numParticles+(di)] = src[3*numParticles+(si)]; \
+    dst##_bits[4*numParticles+(di)] = src##_bits[4*numParticles+(si)];
+
+#elif defined(PARTICLE_COMPACT)
+
+//48 bytes per particle in uvec2 streams of numParticles elements each,the math stays fp32
+//  0: Location,21-bit fixed point per axis inside the domain cube given by the specialization constants
+//  1: Velocity fp16,Density/restDensity fp16
+//  2: DeltaLocation fp16,Lambda*P_LAMBDA_SCALE fp16
+//  3: TmpVelocity fp16,Mass fp16
+//  4: CellHash,TmpCellHash
+//  5: NumNgbrs,Id
+//Density and Lambda are stored scaled so they stay inside the fp16 normal range,
+//only the simulating shaders (which declare restDensity) may touch Density
+#define PARTICLE_STREAM_COUNT 6
+
+layout(constant_id=0) const float domainOriginX = -1.0;
+layout(constant_id=1) const float domainOriginY = -1.0;
+layout(constant_id=2) const float domainOriginZ = -1.0;
+layout(constant_id=3) const float domainExtent = 4.0;
+
+#define P_FIXED_MAX 2097151.0
+#define P_LAMBDA_SCALE 4096.0
+
+uvec2 p_packlocation(vec3 v){
+    vec3 origin = vec3(domainOriginX,domainOriginY,domainOriginZ);
+    uvec3 q = uvec3(clamp((v-origin)/domainExtent,0.0,1.0)*P_FIXED_MAX+0.5);
+    return uvec2(q.x|(q.y<<21),q.z|((q.y>>11)<<21));
+}
+vec3 p_unpacklocation(uvec2 p){
+    vec3 origin = vec3(domainOriginX,domainOriginY,domainOriginZ);
+    uvec3 q = uvec3(p.x&0x1FFFFFu,(p.x>>21)|((p.y>>21)<<11),p.y&0x1FFFFFu);
+    return origin + vec3(q)/P_FIXED_MAX*domainExtent;
+}
+vec4 p_unpackhalf4(uvec2 p){
+    return vec4(unpackHalf2x16(p.x),unpackHalf2x16(p.y));
+}
+uvec2 p_packhalf4(vec4 v){
+    return uvec2(packHalf2x16(v.xy),packHalf2x16(v.zw));
+}
+uvec2 p_setxyz(uvec2 p,vec3 v){
+    return p_packhalf4(vec4(v,p_unpackhalf4(p).w));
+}
+uvec2 p_setw(uvec2 p,float w){
+    vec4 v = p_unpackhalf4(p);
+    v.w = w;
+    return p_packhalf4(v);
+}
+
+#define PARTICLE_ARRAY(name) uvec2 name[];
+#define PARTICLE_BITS(bindingidx,blockname,name)
+
+#define P_LOCATION(buf,i) p_unpacklocation(buf[(i)])
+#define P_VELOCITY(buf,i) p_unpackhalf4(buf[numParticles+(i)]).xyz
+#define P_DENSITY(buf,i) (p_unpackhalf4(buf[numParticles+(i)]).w*restDensity)
+#define P_DELTALOCATION(buf,i) p_unpackhalf4(buf[2*numParticles+(i)]).xyz
+#define P_LAMBDA(buf,i) (p_unpackhalf4(buf[2*numParticles+(i)]).w/P_LAMBDA_SCALE)
+#define P_TMPVELOCITY(buf,i) p_unpackhalf4(buf[3*numParticles+(i)]).xyz
+#define P_MASS(buf,i) p_unpackhalf4(buf[3*numParticles+(i)]).w
+#define P_CELLHASH(buf,i) buf[4*numParticles+(i)].x
+#define P_TMPCELLHASH(buf,i) buf[4*numParticles+(i)].y
+#define P_NUMNGBRS(buf,i) buf[5*numParticles+(i)].x
+#define P_ID(buf,i) buf[5*numParticles+(i)].y
+
+#define P_SET_LOCATION(buf,i,v) buf[(i)] = p_packlocation(v)
+#define P_SET_VELOCITY(buf,i,v) buf[numParticles+(i)] = p_setxyz(buf[numParticles+(i)],(v))
+#define P_SET_DENSITY(buf,i,v) buf[numParticles+(i)] = p_setw(buf[numParticles+(i)],(v)/restDensity)
+#define P_SET_DELTALOCATION(buf,i,v) buf[2*numParticles+(i)] = p_setxyz(buf[2*numParticles+(i)],(v))
+#define P_SET_LAMBDA(buf,i,v) buf[2*numParticles+(i)] = p_setw(buf[2*numParticles+(i)],(v)*P_LAMBDA_SCALE)
+#define P_SET_TMPVELOCITY(buf,i,v) buf[3*numParticles+(i)] = p_setxyz(buf[3*numParticles+(i)],(v))
+#define P_SET_MASS(buf,i,v) buf[3*numParticles+(i)] = p_setw(buf[3*numParticles+(i)],(v))
+
+#define P_COPY(dst,di,src,si) \
+    dst[(di)] = src[(si)]; \
+    dst[numParticles+(di)] = src[numParticles+(si)]; \
+    dst[2*numParticles+(di)] = src[2*numParticles+(si)]; \
+    dst[3*numParticles+(di)] = src[3*numParticles+(si)]; \
+    dst[4*numParticles+(di)] = src[4*numParticles+(si)]; \
+    dst[5*numParticles+(di)] = src[5*numParticles+(si)];
+
+#else
+
+struct Particle{
+    vec3 Location;
+    vec3 Velocity;
+    vec3 DeltaLocation;
+    float Lambda;
+    float Density;
+    float Mass;
+
+    vec3 TmpVelocity;
+
+    uint CellHash;
+    uint TmpCellHash;
+
+    uint NumNgbrs;
+    uint Id;
+};
+
+#define PARTICLE_ARRAY(name) Particle name[];
+#define PARTICLE_BITS(bindingidx,blockname,name)
+
+#define P_LOCATION(buf,i) buf[(i)].Location
+#define P_MASS(buf,i) buf[(i)].Mass
+#define P_VELOCITY(buf,i) buf[(i)].Velocity
+#define P_DENSITY(buf,i) buf[(i)].Density
+#define P_DELTALOCATION(buf,i) buf[(i)].DeltaLocation
+#define P_LAMBDA(buf,i) buf[(i)].Lambda
+#define P_TMPVELOCITY(buf,i) buf[(i)].TmpVelocity
+#define P_CELLHASH(buf,i) buf[(i)].CellHash
+#define P_TMPCELLHASH(buf,i) buf[(i)].TmpCellHash
+#define P_NUMNGBRS(buf,i) buf[(i)].NumNgbrs
+#define P_ID(buf,i) buf[(i)].Id
+
+#define P_COPY(dst,di,src,si) dst[(di)] = src[(si)];
+
+#endif
+
+//fp32 layouts store every field as is
+#ifndef PARTICLE_COMPACT
+#define P_SET_LOCATION(buf,i,v) P_LOCATION(buf,i) = (v)
+#define P_SET_VELOCITY(buf,i,v) P_VELOCITY(buf,i) = (v)
+#define P_SET_DENSITY(buf,i,v) P_DENSITY(buf,i) = (v)
+#define P_SET_DELTALOCATION(buf,i,v) P_DELTALOCATION(buf,i) = (v)
+#define P_SET_LAMBDA(buf,i,v) P_LAMBDA(buf,i) = (v)
+#define P_SET_TMPVELOCITY(buf,i,v) P_TMPVELOCITY(buf,i) = (v)
+#define P_SET_MASS(buf,i,v) P_MASS(buf,i) = (v)
+#endif
+#define P_SET_CELLHASH(buf,i,v) P_CELLHASH(buf,i) = (v)
+#define P_SET_TMPCELLHASH(buf,i,v) P_TMPCELLHASH(buf,i) = (v)
+#define P_SET_NUMNGBRS(buf,i,v) P_NUMNGBRS(buf,i) = (v)
+#define P_SET_ID(buf,i,v) P_ID(buf,i) = (v)
@@ -0,0 +1,13 @@
+//position buffer of the fused solver
+//with fusedSolver on,every iteration is lambda.comp then solve.comp instead of lambda,deltaposition and positionupd:
+//  euler.comp seeds solverpositions with the predicted positions
+//  lambda.comp reads them and commits its own particle's into Location
+//  solve.comp reads Location and writes the corrected positions back into solverpositions (jacobi)
+//  velocityupd.comp commits the positions of the last iteration
+//the iterations also stay in fp32 whatever the particle layout stores
+
+layout(constant_id=5) const bool fusedSolver = false;
+
+layout(binding=9) buffer SolverPositionBuffer{
+    vec4 solverpositions[];
+};
@@ -0,0 +1,488 @@
+#include"cpufluidsolver.h"
+#include"cpusimd.h"
+
+#include<exception>
+#include<stdexcept>
+#include<algorithm>
+#include<cmath>
+
+namespace{
+
+struct SimdVec3{
+    SimdFloat x,y,z;
+};
+SimdVec3 operator+(const SimdVec3& a,const SimdVec3& b){ return {a.x+b.x,a.y+b.y,a.z+b.z}; }
+SimdVec3 operator-(const SimdVec3& a,const SimdVec3& b){ return {a.x-b.x,a.y-b.y,a.z-b.z}; }
+SimdVec3 operator*(const SimdVec3& a,SimdFloat s){ return {a.x*s,a.y*s,a.z*s}; }
+SimdFloat Dot(const SimdVec3& a,const SimdVec3& b){ return a.x*b.x+a.y*b.y+a.z*b.z; }
+SimdVec3 Cross(const SimdVec3& a,const SimdVec3& b){
+    return {a.y*b.z-a.z*b.y,a.z*b.x-a.x*b.z,a.x*b.y-a.y*b.x};
+}
+SimdVec3 Zero3(){ return {SimdZero(),SimdZero(),SimdZero()}; }
+glm::vec3 Sum3(const SimdVec3& a){ return glm::vec3(SimdSum(a.x),SimdSum(a.y),SimdSum(a.z)); }
+
+//W_Poly6 and Grad_W_Spiky of the compute shaders,lanes outside live come back 0
+SimdFloat Poly6(SimdFloat r2,float h,float coff,SimdMask live){
+    SimdFloat item = SimdBroadcast(1.0f)-r2*(1.0f/(h*h));
+    SimdFloat res = item*item*item*coff;
+    return SimdSelect(SimdAnd(live,SimdLessEqual(r2,SimdBroadcast(h*h))),res,SimdZero());
+}
+SimdVec3 GradSpiky(const SimdVec3& r,float h,float coff,SimdMask live){
+    SimdFloat radius = SimdSqrt(Dot(r,r));
+    SimdMask valid = SimdAnd(live,SimdAnd(SimdLess(radius,SimdBroadcast(h)),SimdLess(SimdZero(),radius)));
+    SimdFloat item = SimdBroadcast(1.0f)-radius*(1.0f/h);
+    //normalize(r) folded into the scale,the division by 0 only happens in lanes the select drops
+    SimdFloat scale = SimdSelect(valid,item*item*coff/radius,SimdZero());
+    return r*scale;
+}
+float Poly6(float r2,float h,float coff){
+    if(r2 > h*h){
+        return 0.0f;
+    }
+    float item = 1-r2/(h*h);
+    return coff*item*item*item;
+}
+
+//fn(indices,live) over a neighbor list SIMD_WIDTH at a time,the last lanes repeat self and are not live
+template<typename F>
+void ForNeighborLanes(const uint32_t* list,uint32_t count,uint32_t self,const F& fn){
+    uint32_t k = 0;
+    for(;k+SIMD_WIDTH<=count;k+=SIMD_WIDTH){
+        fn(SimdLoadIndex(list+k),SimdFirstLanes(SIMD_WIDTH));
+    }
+    if(k<count){
+        uint32_t tail[SIMD_WIDTH];
+        for(uint32_t l=0;l<SIMD_WIDTH;++l){
+            tail[l] = k+l<count?list[k+l]:self;
+        }
+        fn(SimdLoadIndex(tail),SimdFirstLanes(count-k));
+    }
+}
+
+SimdVec3 Gather3(const std::vector<float>& x,const std::vector<float>& y,const std::vector<float>& z,SimdIndex j){
+    return {SimdGather(x.data(),j),SimdGather(y.data(),j),SimdGather(z.data(),j)};
+}
+SimdVec3 Broadcast3(float x,float y,float z){
+    return {SimdBroadcast(x),SimdBroadcast(y),SimdBroadcast(z)};
+}
+
+}
+
+CpuFluidSolver::CpuFluidSolver()
+{
+
+}
+CpuFluidSolver::~CpuFluidSolver()
+{
+
+}
+uint32_t CpuFluidSolver::GetSimdWidth()
+{
+    return SIMD_WIDTH;
+}
+
+void CpuFluidSolver::SetSimulatingObj(const UniformSimulatingObject &sobj)
+{
+    if(Initialized){
+        //like the gpu,only the step changes at runtime
+        simulatingobj.dt = sobj.dt;
+        simulatingobj.accumulated_t = sobj.accumulated_t;
+    }
+    else{
+        simulatingobj = sobj;
+    }
+}
+void CpuFluidSolver::SetBoxinfoObj(const UniformBoxInfoObject &bobj)
+{
+    boxinfobjs[0] = bobj;
+}
+void CpuFluidSolver::SetParticles(const std::vector<Particle> &ps)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set particles after the solver initialized!");
+    }
+    else if(particles.size()-domainsizes[0]+ps.size()>=MAX_PARTICLES){
+        throw std::runtime_error("num of particles is too big!");
+    }
+    particles.erase(particles.begin(),particles.begin()+domainsizes[0]);
+    particles.insert(particles.begin(),ps.begin(),ps.end());
+    domainsizes[0] = static_cast<uint32_t>(ps.size());
+}
+uint32_t CpuFluidSolver::AddDomain(const std::vector<Particle> &ps,const UniformSimulatingObject &sobj,const UniformBoxInfoObject &bobj)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not add domains after the solver initialized!");
+    }
+    if(domainobjs.size()>=MAX_FLUID_DOMAINS){
+        throw std::runtime_error("too many fluid domains!");
+    }
+    if(particles.size()+ps.size()>=MAX_PARTICLES){
+        throw std::runtime_error("num of particles is too big!");
+    }
+    if(sobj.sphRadius != simulatingobj.sphRadius || sobj.dt != simulatingobj.dt){
+        throw std::runtime_error("fluid domains should share sphRadius and dt with domain 0!");
+    }
+    domainobjs.push_back(FluidDomainObject{});
+    domainsizes.push_back(static_cast<uint32_t>(ps.size()));
+    boxinfobjs.push_back(bobj);
+    particles.insert(particles.end(),ps.begin(),ps.end());
+    uint32_t index = static_cast<uint32_t>(domainobjs.size()-1);
+    SetDomainSimulatingObj(index,sobj);
+    return index;
+}
+void CpuFluidSolver::SetDomainSimulatingObj(uint32_t domain,const UniformSimulatingObject &sobj)
+{
+    if(domain>=domainobjs.size()){
+        throw std::runtime_error("no such fluid domain!");
+    }
+    domainobjs[domain].restDensity = sobj.restDensity;
+    domainobjs[domain].scorrK = sobj.scorrK;
+    domainobjs[domain].scorrN = sobj.scorrN;
+    domainobjs[domain].scorrQ = sobj.scorrQ;
+}
+void CpuFluidSolver::SetDomainBoxinfoObj(uint32_t domain,const UniformBoxInfoObject &bobj)
+{
+    if(domain>=boxinfobjs.size()){
+        throw std::runtime_error("no such fluid domain!");
+    }
+    boxinfobjs[domain] = bobj;
+}
+void CpuFluidSolver::SetSolverIterations(uint32_t iterations)
+{
+    if(iterations == 0){
+        throw std::runtime_error("solver iterations should be at least 1!");
+    }
+    SolverIterations = iterations;
+}
+void CpuFluidSolver::SetSubsteps(uint32_t substeps)
+{
+    if(substeps == 0){
+        throw std::runtime_error("substeps should be at least 1!");
+    }
+    Substeps = substeps;
+}
+void CpuFluidSolver::SetThreadCount(uint32_t count)
+{
+    ThreadCount = count;
+    if(Initialized){
+        pool = std::make_unique<WorkerPool>(ThreadCount);
+        search.SetPool(pool.get());
+    }
+}
+
+void CpuFluidSolver::Init()
+{
+    if(Initialized){
+        return;
+    }
+    //domain 0 takes its material from the simulating object,as on the gpu
+    SetDomainSimulatingObj(0,simulatingobj);
+
+    size_t n = particles.size();
+    for(auto field:{&x,&y,&z,&px,&py,&pz,&vx,&vy,&vz,&dx,&dy,&dz,&tvx,&tvy,&tvz,&lambda,&density,&mass}){
+        field->resize(n);
+    }
+    id.resize(n);
+    uint32_t index = 0;
+    for(uint32_t d=0;d<domainsizes.size();++d){
+        for(uint32_t i=0;i<domainsizes[d];++i,++index){
+            const Particle& p = particles[index];
+            x[index] = p.Location.x;
+            y[index] = p.Location.y;
+            z[index] = p.Location.z;
+            vx[index] = p.Velocity.x;
+            vy[index] = p.Velocity.y;
+            vz[index] = p.Velocity.z;
+            dx[index] = p.DeltaLocation.x;
+            dy[index] = p.DeltaLocation.y;
+            dz[index] = p.DeltaLocation.z;
+            tvx[index] = p.TmpVelocity.x;
+            tvy[index] = p.TmpVelocity.y;
+            tvz[index] = p.TmpVelocity.z;
+            lambda[index] = p.Lambda;
+            density[index] = p.Density;
+            mass[index] = p.Mass;
+            id[index] = (d<<DOMAIN_ID_SHIFT)|index;
+        }
+    }
+    ngbroffsets.assign(n+1,0);
+    pool = std::make_unique<WorkerPool>(ThreadCount);
+    search.SetPool(pool.get());
+    Initialized = true;
+}
+void CpuFluidSolver::Cleanup()
+{
+    search.SetPool(nullptr);
+    pool.reset();
+    for(auto field:{&x,&y,&z,&px,&py,&pz,&vx,&vy,&vz,&dx,&dy,&dz,&tvx,&tvy,&tvz,&lambda,&density,&mass,&scratch}){
+        field->clear();
+    }
+    id.clear();
+    scratchid.clear();
+    ngbroffsets.clear();
+    ngbrs.clear();
+    Initialized = false;
+}
+
+template<typename F>
+void CpuFluidSolver::ForParticleBlocks(const F& fn)
+{
+    uint32_t n = GetParticleCount();
+    uint32_t blocks = (n+PARTICLE_BLOCK_SIZE-1)/PARTICLE_BLOCK_SIZE;
+    pool->Run(blocks,[&](uint32_t block,uint32_t thread){
+        uint32_t begin = block*PARTICLE_BLOCK_SIZE;
+        fn(begin,std::min(n,begin+PARTICLE_BLOCK_SIZE),thread);
+    });
+}
+
+void CpuFluidSolver::Simulate()
+{
+    SimulateSteps(1);
+}
+void CpuFluidSolver::SimulateSteps(uint32_t steps)
+{
+    if(!Initialized){
+        throw std::runtime_error("you should init the solver before simulating!");
+    }
+    //the pass order of FluidSolver::RecordSimulatingCommandBuffers
+    float dt = simulatingobj.dt/Substeps;
+    for(uint32_t substep=0;substep<steps*Substeps;++substep){
+        Euler(dt);
+        SearchNeighbors();
+        for(uint32_t iter=0;iter<SolverIterations;++iter){
+            ComputeLambda();
+            ComputeDeltaLocation();
+            UpdateLocation();
+        }
+        UpdateVelocity(dt);
+        CacheVelocity();
+        CorrectViscosity();
+        CacheVelocity();
+        CorrectVorticity(dt);
+    }
+}
+
+void CpuFluidSolver::Euler(float dt)
+{
+    ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+        for(uint32_t i=begin;i<end;++i){
+            vy[i] += -9.8f*dt;
+            px[i] = x[i];
+            py[i] = y[i];
+            pz[i] = z[i];
+            x[i] += vx[i]*dt;
+            y[i] += vy[i]*dt;
+            z[i] += vz[i]*dt;
+        }
+    });
+}
+
+void CpuFluidSolver::SearchNeighbors()
+{
+    uint32_t n = GetParticleCount();
+    search.Build(x.data(),y.data(),z.data(),id.data(),n,simulatingobj.sphRadius);
+
+    //every field the next passes read before writing is carried into cell order
+    const std::vector<uint32_t>& order = search.GetOrder();
+    scratch.resize(n);
+    for(auto field:{&x,&y,&z,&px,&py,&pz,&vx,&vy,&vz,&mass}){
+        ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+            for(uint32_t i=begin;i<end;++i){
+                scratch[i] = (*field)[order[i]];
+            }
+        });
+        field->swap(scratch);
+    }
+    scratchid.resize(n);
+    ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+        for(uint32_t i=begin;i<end;++i){
+            scratchid[i] = id[order[i]];
+        }
+    });
+    id.swap(scratchid);
+
+    search.BuildNeighborLists(simulatingobj.sphRadius,ngbroffsets,ngbrs);
+}
+
+void CpuFluidSolver::ComputeLambda()
+{
+    float h = simulatingobj.sphRadius;
+    float coffPoly6 = simulatingobj.coffPoly6;
+    float coffGradSpiky = simulatingobj.coffGradSpiky;
+    ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+        for(uint32_t i=begin;i<end;++i){
+            const FluidDomainObject& domain = domainobjs[id[i]>>DOMAIN_ID_SHIFT];
+            SimdVec3 loc = Broadcast3(x[i],y[i],z[i]);
+            SimdFloat dens = SimdZero();
+            SimdFloat denom = SimdZero();
+            SimdVec3 gradi = Zero3();
+            ForNeighborLanes(&ngbrs[ngbroffsets[i]],ngbroffsets[i+1]-ngbroffsets[i],i,[&](SimdIndex j,SimdMask live){
+                SimdVec3 r = loc-Gather3(x,y,z,j);
+                dens = dens+Poly6(Dot(r,r),h,coffPoly6,live);
+                SimdVec3 gradj = GradSpiky(r,h,coffGradSpiky,live)*SimdBroadcast(1.0f/domain.restDensity);
+                gradi = gradi+gradj;
+                denom = denom+Dot(gradj,gradj);
+            });
+            float Density = SimdSum(dens)+Poly6(0.0f,h,coffPoly6);
+            glm::vec3 g = Sum3(gradi);
+            float denominator = SimdSum(denom)+glm::dot(g,g)+1e4f;
+            density[i] = Density;
+            lambda[i] = -(Density/domain.restDensity-1)/denominator;
+        }
+    });
+}
+
+void CpuFluidSolver::ComputeDeltaLocation()
+{
+    float h = simulatingobj.sphRadius;
+    float coffPoly6 = simulatingobj.coffPoly6;
+    float coffGradSpiky = simulatingobj.coffGradSpiky;
+    ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+        for(uint32_t i=begin;i<end;++i){
+            const FluidDomainObject& domain = domainobjs[id[i]>>DOMAIN_ID_SHIFT];
+            float wq = Poly6(domain.scorrQ*h*domain.scorrQ*h,h,coffPoly6);
+            SimdVec3 loc = Broadcast3(x[i],y[i],z[i]);
+            SimdFloat lambdai = SimdBroadcast(lambda[i]);
+            SimdVec3 delta = Zero3();
+            ForNeighborLanes(&ngbrs[ngbroffsets[i]],ngbroffsets[i+1]-ngbroffsets[i],i,[&](SimdIndex j,SimdMask live){
+                SimdVec3 r = loc-Gather3(x,y,z,j);
+                SimdFloat wdiff = SimdAbs(Poly6(Dot(r,r),h,coffPoly6,live)*(1.0f/wq));
+                SimdFloat scorr = SimdPow(wdiff,domain.scorrN)*(-domain.scorrK);
+                SimdFloat s = lambdai+SimdGather(lambda.data(),j)+scorr;
+                delta = delta+GradSpiky(r,h,coffGradSpiky,live)*s;
+            });
+            glm::vec3 d = Sum3(delta)/domain.restDensity;
+            dx[i] = d.x;
+            dy[i] = d.y;
+            dz[i] = d.z;
+        }
+    });
+}
+
+void CpuFluidSolver::UpdateLocation()
+{
+    float radius = simulatingobj.sphRadius/4;
+    ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+        for(uint32_t i=begin;i<end;++i){
+            const UniformBoxInfoObject& box = boxinfobjs[id[i]>>DOMAIN_ID_SHIFT];
+            glm::vec3 delta(dx[i],dy[i],dz[i]);
+            glm::vec3 star = glm::vec3(x[i],y[i],z[i])+delta;
+            //nearest wall in the order of positionupd.comp,ties go to the earlier one
+            float dists[6] = {star.x-box.clampX.x,box.clampX.y-star.x,box.clampZ.y-star.z,star.z-box.clampZ.x,star.y-box.clampY.x,box.clampY.y-star.y};
+            const glm::vec3 normals[6] = {{1,0,0},{-1,0,0},{0,0,-1},{0,0,1},{0,1,0},{0,-1,0}};
+            float walldist = dists[0];
+            glm::vec3 wallnormal = normals[0];
+            for(int w=1;w<6;++w){
+                if(dists[w] < walldist){
+                    walldist = dists[w];
+                    wallnormal = normals[w];
+                }
+            }
+            if(walldist < radius){
+                delta += (radius-walldist)*wallnormal;
+            }
+            x[i] += delta.x;
+            y[i] += delta.y;
+            z[i] += delta.z;
+        }
+    });
+}
+
+void CpuFluidSolver::UpdateVelocity(float dt)
+{
+    ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+        for(uint32_t i=begin;i<end;++i){
+            vx[i] = (x[i]-px[i])/dt;
+            vy[i] = (y[i]-py[i])/dt;
+            vz[i] = (z[i]-pz[i])/dt;
+        }
+    });
+}
+
+void CpuFluidSolver::CacheVelocity()
+{
+    ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+        std::copy(vx.begin()+begin,vx.begin()+end,tvx.begin()+begin);
+        std::copy(vy.begin()+begin,vy.begin()+end,tvy.begin()+begin);
+        std::copy(vz.begin()+begin,vz.begin()+end,tvz.begin()+begin);
+    });
+}
+
+void CpuFluidSolver::CorrectViscosity()
+{
+    float h = simulatingobj.sphRadius;
+    float coffPoly6 = simulatingobj.coffPoly6;
+    ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+        for(uint32_t i=begin;i<end;++i){
+            const FluidDomainObject& domain = domainobjs[id[i]>>DOMAIN_ID_SHIFT];
+            SimdVec3 loc = Broadcast3(x[i],y[i],z[i]);
+            SimdVec3 veli = Broadcast3(vx[i],vy[i],vz[i]);
+            SimdVec3 dv = Zero3();
+            ForNeighborLanes(&ngbrs[ngbroffsets[i]],ngbroffsets[i+1]-ngbroffsets[i],i,[&](SimdIndex j,SimdMask live){
+                SimdVec3 r = loc-Gather3(x,y,z,j);
+                dv = dv+(Gather3(tvx,tvy,tvz,j)-veli)*Poly6(Dot(r,r),h,coffPoly6,live);
+            });
+            glm::vec3 correction = 0.01f*Sum3(dv)/domain.restDensity;
+            vx[i] += correction.x;
+            vy[i] += correction.y;
+            vz[i] += correction.z;
+        }
+    });
+}
+
+void CpuFluidSolver::CorrectVorticity(float dt)
+{
+    float h = simulatingobj.sphRadius;
+    float coffGradSpiky = simulatingobj.coffGradSpiky;
+    ForParticleBlocks([&](uint32_t begin,uint32_t end,uint32_t){
+        for(uint32_t i=begin;i<end;++i){
+            SimdVec3 loc = Broadcast3(x[i],y[i],z[i]);
+            SimdVec3 veli = Broadcast3(tvx[i],tvy[i],tvz[i]);
+            SimdVec3 omega = Zero3(),omegadx = Zero3(),omegady = Zero3(),omegadz = Zero3();
+            ForNeighborLanes(&ngbrs[ngbroffsets[i]],ngbroffsets[i+1]-ngbroffsets[i],i,[&](SimdIndex j,SimdMask live){
+                SimdVec3 vgap = Gather3(tvx,tvy,tvz,j)-veli;
+                SimdVec3 r = loc-Gather3(x,y,z,j);
+                omega = omega-Cross(vgap,GradSpiky(r,h,coffGradSpiky,live));
+                omegadx = omegadx+Cross(vgap,GradSpiky({r.x+0.001f,r.y,r.z},h,coffGradSpiky,live));
+                omegady = omegady+Cross(vgap,GradSpiky({r.x,r.y+0.001f,r.z},h,coffGradSpiky,live));
+                omegadz = omegadz+Cross(vgap,GradSpiky({r.x,r.y,r.z+0.001f},h,coffGradSpiky,live));
+            });
+            glm::vec3 w = Sum3(omega);
+            float wlength = glm::length(w);
+            glm::vec3 N(glm::length(Sum3(omegadx))-wlength,glm::length(Sum3(omegady))-wlength,glm::length(Sum3(omegadz))-wlength);
+            N = N/glm::length(N);
+            if(std::isnan(N.x) || std::isnan(N.y) || std::isnan(N.z)){
+                continue;
+            }
+            glm::vec3 force = 5e-8f*glm::cross(N,w);
+            vx[i] += force.x*dt;
+            vy[i] += force.y*dt;
+            vz[i] += force.z*dt;
+        }
+    });
+}
+
+void CpuFluidSolver::GetParticles(std::vector<Particle> &ps)
+{
+    if(!Initialized){
+        ps = particles;
+        return;
+    }
+    uint32_t n = GetParticleCount();
+    ps.resize(n);
+    for(uint32_t i=0;i<n;++i){
+        Particle& p = ps[i];
+        p = Particle{};
+        p.Location = glm::vec3(x[i],y[i],z[i]);
+        p.Velocity = glm::vec3(vx[i],vy[i],vz[i]);
+        p.DeltaLocation = glm::vec3(dx[i],dy[i],dz[i]);
+        p.TmpVelocity = glm::vec3(tvx[i],tvy[i],tvz[i]);
+        p.Lambda = lambda[i];
+        p.Density = density[i];
+        p.Mass = mass[i];
+        p.CellHash = i<search.GetPointCount() ? search.GetCellKeys()[i] : 0;
+        p.NumNgbrs = ngbroffsets[i+1]-ngbroffsets[i];
+        p.Id = id[i];
+    }
+    std::sort(ps.begin(),ps.end(),[](const Particle& a,const Particle& b){ return a.Id<b.Id; });
+}
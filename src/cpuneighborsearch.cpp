@@ -0,0 +1,256 @@
+#include"cpuneighborsearch.h"
+#include"cpusimd.h"
+
+#include<exception>
+#include<stdexcept>
+#include<atomic>
+#include<limits>
+#include<cmath>
+#include<bit>
+
+CpuNeighborSearch::CpuNeighborSearch(WorkerPool* pool):pool(pool)
+{
+
+}
+void CpuNeighborSearch::SetPool(WorkerPool* p)
+{
+    pool = p;
+}
+
+template<typename F>
+void CpuNeighborSearch::ForBlocks(uint32_t count,uint32_t blocksize,const F& fn)
+{
+    uint32_t blocks = (count+blocksize-1)/blocksize;
+    auto block = [&](uint32_t b,uint32_t){
+        uint32_t begin = b*blocksize;
+        fn(begin,std::min(count,begin+blocksize));
+    };
+    if(pool){
+        pool->Run(blocks,block);
+    }
+    else{
+        for(uint32_t b=0;b<blocks;++b){
+            block(b,0);
+        }
+    }
+}
+
+void CpuNeighborSearch::Build(const std::vector<Particle> &ps,float cellsize)
+{
+    uint32_t n = static_cast<uint32_t>(ps.size());
+    std::vector<float> x(n),y(n),z(n);
+    std::vector<uint32_t> ids(n);
+    ForBlocks(n,POINT_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        for(uint32_t i=begin;i<end;++i){
+            x[i] = ps[i].Location.x;
+            y[i] = ps[i].Location.y;
+            z[i] = ps[i].Location.z;
+            ids[i] = ps[i].Id;
+        }
+    });
+    Build(x.data(),y.data(),z.data(),ids.data(),n,cellsize);
+}
+
+void CpuNeighborSearch::Build(const float* x,const float* y,const float* z,const uint32_t* ids,uint32_t count,float cellsize)
+{
+    if(!(cellsize > 0)){
+        throw std::runtime_error("cell size should be positive!");
+    }
+    ComputeGrid(x,y,z,ids,count,cellsize);
+    SortCells(x,y,z,ids,count);
+}
+
+void CpuNeighborSearch::ComputeGrid(const float* x,const float* y,const float* z,const uint32_t* ids,uint32_t count,float cellsize)
+{
+    uint32_t blocks = (count+POINT_BLOCK_SIZE-1)/POINT_BLOCK_SIZE;
+    std::vector<glm::vec3> blockmin(blocks,glm::vec3(std::numeric_limits<float>::max()));
+    std::vector<glm::vec3> blockmax(blocks,glm::vec3(-std::numeric_limits<float>::max()));
+    std::vector<uint32_t> blockdomains(blocks,0);
+    ForBlocks(count,POINT_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        uint32_t b = begin/POINT_BLOCK_SIZE;
+        for(uint32_t i=begin;i<end;++i){
+            glm::vec3 p(x[i],y[i],z[i]);
+            blockmin[b] = glm::min(blockmin[b],p);
+            blockmax[b] = glm::max(blockmax[b],p);
+            if(ids){
+                blockdomains[b] = std::max(blockdomains[b],ids[i]>>DOMAIN_ID_SHIFT);
+            }
+        }
+    });
+    glm::vec3 lo(0.0f),hi(0.0f);
+    DomainCount = 1;
+    for(uint32_t b=0;b<blocks;++b){
+        lo = b==0 ? blockmin[b] : glm::min(lo,blockmin[b]);
+        hi = b==0 ? blockmax[b] : glm::max(hi,blockmax[b]);
+        DomainCount = std::max(DomainCount,blockdomains[b]+1);
+    }
+    glm::vec3 extent = hi-lo;
+    if(!std::isfinite(extent.x) || !std::isfinite(extent.y) || !std::isfinite(extent.z)){
+        throw std::runtime_error("particles left the finite range!");
+    }
+
+    //cells as wide as asked,widened when scattered points would need more than a few cells each
+    double limit = std::max(4.0*count,65536.0);
+    GridOrigin = lo;
+    CellSize = cellsize;
+    for(;;){
+        GridSize = glm::ivec3(glm::floor(extent/CellSize))+glm::ivec3(1);
+        double cells = static_cast<double>(DomainCount)*GridSize.x*GridSize.y*GridSize.z;
+        if(cells <= limit){
+            break;
+        }
+        CellSize *= static_cast<float>(std::cbrt(cells/limit))*1.01f;
+    }
+}
+
+void CpuNeighborSearch::SortCells(const float* x,const float* y,const float* z,const uint32_t* ids,uint32_t count)
+{
+    uint32_t cellcount = DomainCount*GridSize.x*GridSize.y*GridSize.z;
+    inputkeys.resize(count);
+    ranks.resize(count);
+    cellstart.assign(cellcount+1,0);
+
+    //cellcount.comp:every point takes its slot in its cell
+    ForBlocks(count,POINT_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        for(uint32_t i=begin;i<end;++i){
+            glm::vec3 t = (glm::vec3(x[i],y[i],z[i])-GridOrigin)/CellSize;
+            glm::ivec3 c = glm::clamp(glm::ivec3(t),glm::ivec3(0),GridSize-glm::ivec3(1));
+            uint32_t d = ids ? ids[i]>>DOMAIN_ID_SHIFT : 0;
+            uint32_t key = ((d*GridSize.z+c.z)*GridSize.y+c.y)*GridSize.x+c.x;
+            inputkeys[i] = key;
+            ranks[i] = std::atomic_ref<uint32_t>(cellstart[key]).fetch_add(1,std::memory_order_relaxed);
+        }
+    });
+
+    //cellscan.comp:exclusive scan of the counts,block sums first
+    uint32_t cellblocks = (cellcount+CELL_BLOCK_SIZE-1)/CELL_BLOCK_SIZE;
+    blocksums.assign(cellblocks+1,0);
+    ForBlocks(cellcount,CELL_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        uint32_t sum = 0;
+        for(uint32_t k=begin;k<end;++k){
+            sum += cellstart[k];
+        }
+        blocksums[begin/CELL_BLOCK_SIZE+1] = sum;
+    });
+    for(uint32_t b=0;b<cellblocks;++b){
+        blocksums[b+1] += blocksums[b];
+    }
+    ForBlocks(cellcount,CELL_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        uint32_t sum = blocksums[begin/CELL_BLOCK_SIZE];
+        for(uint32_t k=begin;k<end;++k){
+            uint32_t cellsize = cellstart[k];
+            cellstart[k] = sum;
+            sum += cellsize;
+        }
+    });
+    cellstart[cellcount] = count;
+
+    //cellscatter.comp
+    order.resize(count);
+    ForBlocks(count,POINT_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        for(uint32_t i=begin;i<end;++i){
+            order[cellstart[inputkeys[i]]+ranks[i]] = i;
+        }
+    });
+    //the slots were taken in whatever order the threads got there,input order within a cell keeps every build repeatable
+    ForBlocks(cellcount,CELL_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        for(uint32_t k=begin;k<end;++k){
+            if(cellstart[k+1]-cellstart[k] > 1){
+                std::sort(order.begin()+cellstart[k],order.begin()+cellstart[k+1]);
+            }
+        }
+    });
+
+    //positions in cell order for the searches
+    cellkeys.resize(count);
+    sx.resize(count);
+    sy.resize(count);
+    sz.resize(count);
+    ForBlocks(count,POINT_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        for(uint32_t i=begin;i<end;++i){
+            uint32_t src = order[i];
+            cellkeys[i] = inputkeys[src];
+            sx[i] = x[src];
+            sy[i] = y[src];
+            sz[i] = z[src];
+        }
+    });
+}
+
+void CpuNeighborSearch::BuildNeighborLists(float radius,std::vector<uint32_t> &offsets,std::vector<uint32_t> &ngbrs)
+{
+    if(radius > CellSize){
+        throw std::runtime_error("neighbor lists only reach one cell out!");
+    }
+    uint32_t n = GetPointCount();
+    uint32_t blocks = (n+POINT_BLOCK_SIZE-1)/POINT_BLOCK_SIZE;
+    float r2 = radius*radius;
+    SimdFloat simdr2 = SimdBroadcast(r2);
+    blockngbrs.resize(blocks);
+    offsets.resize(n+1);
+
+    //the points of a block share their cells,so the candidate rows stay in cache from one point to the next
+    ForBlocks(n,POINT_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        std::vector<uint32_t>& list = blockngbrs[begin/POINT_BLOCK_SIZE];
+        list.clear();
+        for(uint32_t i=begin;i<end;++i){
+            offsets[i] = static_cast<uint32_t>(list.size());
+            uint32_t key = cellkeys[i];
+            int cx = static_cast<int>(key%GridSize.x);
+            int cy = static_cast<int>((key/GridSize.x)%GridSize.y);
+            int cz = static_cast<int>((key/(GridSize.x*GridSize.y))%GridSize.z);
+            uint32_t domainbase = key-((cz*GridSize.y+cy)*GridSize.x+cx);
+            int x0 = std::max(cx-1,0),x1 = std::min(cx+1,GridSize.x-1);
+            SimdFloat lx = SimdBroadcast(sx[i]),ly = SimdBroadcast(sy[i]),lz = SimdBroadcast(sz[i]);
+            for(int zz=std::max(cz-1,0);zz<=std::min(cz+1,GridSize.z-1);++zz){
+                for(int yy=std::max(cy-1,0);yy<=std::min(cy+1,GridSize.y-1);++yy){
+                    //x runs fastest,the three cells of a row are one range of points
+                    uint32_t row = domainbase+(zz*GridSize.y+yy)*GridSize.x;
+                    uint32_t j = cellstart[row+x0];
+                    uint32_t last = cellstart[row+x1+1];
+                    for(;j+SIMD_WIDTH<=last;j+=SIMD_WIDTH){
+                        SimdFloat rx = lx-SimdLoad(&sx[j]);
+                        SimdFloat ry = ly-SimdLoad(&sy[j]);
+                        SimdFloat rz = lz-SimdLoad(&sz[j]);
+                        uint32_t bits = SimdMaskBits(SimdLess(rx*rx+ry*ry+rz*rz,simdr2));
+                        for(;bits;bits&=bits-1){
+                            uint32_t ngbr = j+static_cast<uint32_t>(std::countr_zero(bits));
+                            if(ngbr != i){
+                                list.push_back(ngbr);
+                            }
+                        }
+                    }
+                    for(;j<last;++j){
+                        float rx = sx[i]-sx[j],ry = sy[i]-sy[j],rz = sz[i]-sz[j];
+                        if(j != i && rx*rx+ry*ry+rz*rz < r2){
+                            list.push_back(j);
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    //blocks are laid out one after another
+    std::vector<uint32_t> blockbase(blocks+1,0);
+    for(uint32_t b=0;b<blocks;++b){
+        blockbase[b+1] = blockbase[b]+static_cast<uint32_t>(blockngbrs[b].size());
+    }
+    ngbrs.resize(blockbase[blocks]);
+    ForBlocks(n,POINT_BLOCK_SIZE,[&](uint32_t begin,uint32_t end){
+        uint32_t b = begin/POINT_BLOCK_SIZE;
+        std::copy(blockngbrs[b].begin(),blockngbrs[b].end(),ngbrs.begin()+blockbase[b]);
+        for(uint32_t i=begin;i<end;++i){
+            offsets[i] += blockbase[b];
+        }
+    });
+    offsets[n] = blockbase[blocks];
+}
+
+void CpuNeighborSearch::QueryRadius(glm::vec3 location,float radius,uint32_t domain,std::vector<uint32_t> &result) const
+{
+    result.clear();
+    ForEachInRadius(location,radius,domain,[&](uint32_t index,float){
+        result.push_back(index);
+    });
+}
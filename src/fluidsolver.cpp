@@ -0,0 +1,2670 @@
+#include"fluidsolver.h"
+#include"helperfuncs.h"
+
+#include<iostream>
+#include<cstring>
+#include<cstdio>
+#include<exception>
+#include<array>
+#include<algorithm>
+#include<bit>
+#include<limits>
+#include<numbers>
+
+
+#define Allocator nullptr
+std::string FluidSolver::GetParticleShaderPath(const char* name)
+{
+    //every compute shader is built once per particle layout,see CMakeLists.txt
+    std::string path = std::string("resources/shaders/spv/compshader_")+name;
+    if(particlelayout == ParticleLayout::SOA){
+        path += "_soa";
+    }
+    else if(particlelayout == ParticleLayout::COMPACT){
+        path += "_compact";
+    }
+    return path+".spv";
+}
+VkSpecializationInfo* FluidSolver::GetParticleSpecialization()
+{
+    //constant_id 0-3 of particle.glsl,4 of neighbor.glsl,5 of solver.glsl and 6-12 of domain.glsl,shaders without them ignore the entries
+    ParticleSpecializationData.DomainOrigin[0] = CompactDomainOrigin.x;
+    ParticleSpecializationData.DomainOrigin[1] = CompactDomainOrigin.y;
+    ParticleSpecializationData.DomainOrigin[2] = CompactDomainOrigin.z;
+    ParticleSpecializationData.DomainExtent = CompactDomainExtent;
+    ParticleSpecializationData.NeighborMode = static_cast<uint32_t>(neighbormode);
+    ParticleSpecializationData.FusedSolver = bFusedSolver ? VK_TRUE : VK_FALSE;
+    ParticleSpecializationData.CellIndexMode = static_cast<uint32_t>(cellindexmode);
+    for(uint32_t i=0;i<3;++i){
+        ParticleSpecializationData.CellGridMin[i] = CellGridMin[i];
+        ParticleSpecializationData.CellGridDim[i] = CellGridDim[i];
+    }
+    //every entry is 4 bytes wide
+    for(uint32_t i=0;i<ParticleSpecializationEntries.size();++i){
+        ParticleSpecializationEntries[i].constantID = i;
+        ParticleSpecializationEntries[i].offset = sizeof(uint32_t)*i;
+        ParticleSpecializationEntries[i].size = sizeof(uint32_t);
+    }
+    ParticleSpecializationInfo.mapEntryCount = static_cast<uint32_t>(ParticleSpecializationEntries.size());
+    ParticleSpecializationInfo.pMapEntries = ParticleSpecializationEntries.data();
+    ParticleSpecializationInfo.dataSize = sizeof(ParticleSpecializationData);
+    ParticleSpecializationInfo.pData = &ParticleSpecializationData;
+    return &ParticleSpecializationInfo;
+}
+VkShaderModule FluidSolver::MakeShaderModule(const char *filename)
+{
+    std::vector<char> bytes;
+    HelperFuncs::ReadFile(filename,bytes);
+    VkShaderModuleCreateInfo createinfo{};
+    createinfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createinfo.codeSize = bytes.size();
+    createinfo.pCode = reinterpret_cast<uint32_t*>(bytes.data());
+    VkShaderModule module;
+    if(vkCreateShaderModule(LDevice,&createinfo,Allocator,&module)!=VK_SUCCESS){
+        throw std::runtime_error("failed to create shader module!");
+    }
+    return module;
+   
+}
+VkCommandBuffer FluidSolver::CreateCommandBuffer()
+{
+ 
+    VkCommandBuffer cb;
+    VkCommandBufferAllocateInfo allocateinfo{};
+    allocateinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateinfo.commandPool = CommandPool;
+    allocateinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateinfo.commandBufferCount = 1;
+    if(vkAllocateCommandBuffers(LDevice,&allocateinfo,&cb)!=VK_SUCCESS){
+        throw std::runtime_error("failed to allocate command buffer!");
+    }
+    VkCommandBufferBeginInfo begininfo{};
+    begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begininfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if(vkBeginCommandBuffer(cb,&begininfo)!=VK_SUCCESS){
+        throw std::runtime_error("failed to begin command buffer!");
+    }
+    return cb;
+}
+void FluidSolver::SubmitCommandBuffer(VkCommandBuffer& cb,VkSubmitInfo submitinfo,VkFence fence,VkQueue queue)
+{
+    submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitinfo.commandBufferCount = 1;
+    submitinfo.pCommandBuffers = &cb;
+    if(vkEndCommandBuffer(cb)!=VK_SUCCESS){
+        throw std::runtime_error("failed to end command buffer!");
+    }
+    if(vkQueueSubmit(queue,1,&submitinfo,fence)!=VK_SUCCESS){
+        throw std::runtime_error("failed to submit command buffer!");
+    }
+    vkDeviceWaitIdle(LDevice);
+    vkFreeCommandBuffers(LDevice,CommandPool,1,&cb);
+}
+void FluidSolver::CreateBuffer(VkBuffer &buffer, VkDeviceMemory &memory,VkDeviceSize size,VkBufferUsageFlags usage,VkMemoryPropertyFlags mempropperties)
+{
+    VkBufferCreateInfo createinfo{};
+    createinfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    createinfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createinfo.size = size;
+    createinfo.usage = usage;
+    if(vkCreateBuffer(LDevice,&createinfo,Allocator,&buffer)!=VK_SUCCESS){
+        throw std::runtime_error("failed to create buffer!");
+    }
+    VkMemoryRequirements requirements{};
+    vkGetBufferMemoryRequirements(LDevice,buffer,&requirements);
+    VkMemoryAllocateInfo allocateinfo{};
+    allocateinfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateinfo.allocationSize = requirements.size;
+    allocateinfo.memoryTypeIndex = ChooseMemoryType(requirements.memoryTypeBits,mempropperties);
+    
+    if(vkAllocateMemory(LDevice,&allocateinfo,Allocator,&memory)!=VK_SUCCESS){
+        throw std::runtime_error("failed to allocate memory for buffer!");
+    }
+    vkBindBufferMemory(LDevice,buffer,memory,0);
+    DeviceMemoryUsage += requirements.size;
+    PeakDeviceMemoryUsage = std::max(PeakDeviceMemoryUsage,DeviceMemoryUsage);
+}
+uint32_t FluidSolver::ChooseMemoryType(uint32_t typefilter, VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memproperties{};
+    vkGetPhysicalDeviceMemoryProperties(PDevice,&memproperties);
+    for(uint32_t i=0;i<memproperties.memoryTypeCount;++i){
+        if(!(typefilter&(1<<i))) continue;
+        if((properties&memproperties.memoryTypes[i].propertyFlags) == properties){
+            return i;
+        }
+    }
+    throw std::runtime_error("failed to choose a suitable memory type!");
+}
+void FluidSolver::CleanupBuffer(VkBuffer &buffer, VkDeviceMemory &memory,bool mapped)
+{
+    if(mapped)
+        vkUnmapMemory(LDevice,memory);
+    VkMemoryRequirements requirements{};
+    vkGetBufferMemoryRequirements(LDevice,buffer,&requirements);
+    DeviceMemoryUsage -= requirements.size;
+    vkDestroyBuffer(LDevice,buffer,Allocator);
+    vkFreeMemory(LDevice,memory,Allocator);
+}
+void FluidSolver::SetSimulatingObj(const UniformSimulatingObject &sobj)
+{
+    if(Initialized){
+        vkQueueWaitIdle(ComputeQueue);
+        auto pObj = reinterpret_cast<UniformSimulatingObject*>(MappedSimulatingBuffer);
+        simulatingobj.dt = sobj.dt;
+        simulatingobj.accumulated_t = sobj.accumulated_t;
+        //dt is the frame step,every substep advances a part of it
+        pObj->dt = sobj.dt/Substeps;
+        pObj->accumulated_t = sobj.accumulated_t;
+    }
+    else{
+        simulatingobj = sobj;
+    }
+}
+void FluidSolver::SetNSObj(const UniformNSObject &nobj)
+{
+    if(Initialized){
+         vkQueueWaitIdle(ComputeQueue);
+        uint32_t oldhashsize = nsobject.hashsize;
+        //the particle buffers stay sized for the capacity they were created with,the dense grid owns hashsize
+        bool regrow = false;
+        bool rebuild = false;
+        float radius = nobj.sphRadius + nsobject.skin;
+        if(cellindexmode == CellIndexMode::HASH){
+            nsobject.hashsize = nobj.hashsize;
+            regrow = nsobject.hashsize > CellinfoCapacity;
+        }
+        else if(radius != nsobject.sphRadius){
+            //the dense grid is cut in cells of the radius and baked into the pipelines as specialization constants
+            ComputeCellGrid(radius);
+            regrow = true;
+            rebuild = true;
+        }
+        nsobject.sphRadius = radius;
+        memcpy(MappedNSBuffer,&nsobject,sizeof(UniformNSObject));
+        //the kept lists were searched with the old radius and cells
+        if(nsobject.skin > 0){
+            ForceNeighborRebuild();
+        }
+        //the counting sort dispatches its scan over the cells
+        if(regrow){
+            RegrowCellBuffers();
+        }
+        if(regrow || GetRadixsortPasses(nsobject.hashsize) != RADIX_SORT_PASSES || (radixsortmode == RadixsortMode::COUNTING && nsobject.hashsize != oldhashsize)){
+            RADIX_SORT_PASSES = GetRadixsortPasses(nsobject.hashsize);
+            if(rebuild){
+                CleanupComputePipeline();
+                CreateComputePipeline();
+            }
+            WriteSimulateNeighborDescriptors();
+            vkFreeCommandBuffers(LDevice,CommandPool,static_cast<uint32_t>(SimulatingCommandBuffers.size()),SimulatingCommandBuffers.data());
+            RecordSimulatingCommandBuffers();
+            vkFreeCommandBuffers(LDevice,CommandPool,static_cast<uint32_t>(ReorderCommandBuffers.size()),ReorderCommandBuffers.data());
+            RecordReorderCommandBuffers();
+        }
+    }
+    else{
+        nsobject = nobj;
+        nsobject.ngbrcapacity = NgbrCapacity;
+    }
+}
+void FluidSolver::SetBoxinfoObj(const UniformBoxInfoObject &bobj)
+{
+    if(Initialized){
+        vkQueueWaitIdle(ComputeQueue);
+        memcpy(MappedBoxInfoBuffer,&bobj,sizeof(UniformBoxInfoObject));
+    }
+    boxinfobjs[0] = bobj;
+}
+void FluidSolver::SetParticles(const std::vector<Particle> &ps)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set particles after vulkan initialized!");
+    }
+    else if(particles.size()-domainsizes[0]+ps.size()>=MAX_PARTICLES){
+       throw std::runtime_error("num of particles is too big!");
+    }
+    else{
+        //domain 0 is the front of the particle array
+        particles.erase(particles.begin(),particles.begin()+domainsizes[0]);
+        particles.insert(particles.begin(),ps.begin(),ps.end());
+        domainsizes[0] = static_cast<uint32_t>(ps.size());
+    }
+}
+uint32_t FluidSolver::AddDomain(const std::vector<Particle> &ps,const UniformSimulatingObject &sobj,const UniformBoxInfoObject &bobj)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not add domains after vulkan initialized!");
+    }
+    if(domainobjs.size()>=MAX_FLUID_DOMAINS){
+        throw std::runtime_error("too many fluid domains!");
+    }
+    if(particles.size()+ps.size()>=MAX_PARTICLES){
+        throw std::runtime_error("num of particles is too big!");
+    }
+    //every domain is hashed into the same grid and integrated with the same step
+    if(sobj.sphRadius != simulatingobj.sphRadius || sobj.dt != simulatingobj.dt){
+        throw std::runtime_error("fluid domains should share sphRadius and dt with domain 0!");
+    }
+    domainobjs.push_back(FluidDomainObject{});
+    domainsizes.push_back(static_cast<uint32_t>(ps.size()));
+    boxinfobjs.push_back(bobj);
+    particles.insert(particles.end(),ps.begin(),ps.end());
+    uint32_t index = static_cast<uint32_t>(domainobjs.size()-1);
+    SetDomainSimulatingObj(index,sobj);
+    return index;
+}
+void FluidSolver::SetDomainSimulatingObj(uint32_t domain,const UniformSimulatingObject &sobj)
+{
+    if(domain>=domainobjs.size()){
+        throw std::runtime_error("no such fluid domain!");
+    }
+    domainobjs[domain].restDensity = sobj.restDensity;
+    domainobjs[domain].scorrK = sobj.scorrK;
+    domainobjs[domain].scorrN = sobj.scorrN;
+    domainobjs[domain].scorrQ = sobj.scorrQ;
+    if(Initialized){
+        vkQueueWaitIdle(ComputeQueue);
+        reinterpret_cast<FluidDomainObject*>(MappedDomainBuffer)[domain] = domainobjs[domain];
+    }
+}
+void FluidSolver::SetDomainBoxinfoObj(uint32_t domain,const UniformBoxInfoObject &bobj)
+{
+    if(domain>=boxinfobjs.size()){
+        throw std::runtime_error("no such fluid domain!");
+    }
+    boxinfobjs[domain] = bobj;
+    if(Initialized){
+        vkQueueWaitIdle(ComputeQueue);
+        reinterpret_cast<UniformBoxInfoObject*>(MappedBoxInfoBuffer)[domain] = bobj;
+    }
+}
+void FluidSolver::SetParticleCapacity(uint32_t capacity)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set particle capacity after vulkan initialized!");
+    }
+    if(capacity>=MAX_PARTICLES){
+        throw std::runtime_error("particle capacity is too big!");
+    }
+    ParticleCapacity = capacity;
+}
+uint32_t FluidSolver::AddEmitter(const ParticleEmitterObject &emitter)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not add emitters after vulkan initialized!");
+    }
+    if(emitter.domain>=domainobjs.size()){
+        throw std::runtime_error("no such fluid domain!");
+    }
+    emitterobjs.push_back(emitter);
+    return static_cast<uint32_t>(emitterobjs.size()-1);
+}
+void FluidSolver::SetEmitter(uint32_t index,const ParticleEmitterObject &emitter)
+{
+    if(index>=emitterobjs.size()){
+        throw std::runtime_error("no such emitter!");
+    }
+    if(emitter.domain>=domainobjs.size()){
+        throw std::runtime_error("no such fluid domain!");
+    }
+    if(!Initialized){
+        emitterobjs[index] = emitter;
+        return;
+    }
+    vkQueueWaitIdle(ComputeQueue);
+    uint32_t groupcount = GetEmitGroupCount();
+    emitterobjs[index] = emitter;
+    reinterpret_cast<ParticleEmitterObject*>(MappedEmitterBuffer)[index] = emitter;
+    //the emit dispatch is sized from the layers,a new side needs the command buffers recorded again
+    if(GetEmitGroupCount() != groupcount){
+        vkFreeCommandBuffers(LDevice,CommandPool,static_cast<uint32_t>(SimulatingCommandBuffers.size()),SimulatingCommandBuffers.data());
+        RecordSimulatingCommandBuffers();
+    }
+}
+uint32_t FluidSolver::AddSink(const ParticleSinkObject &sink)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not add sinks after vulkan initialized!");
+    }
+    sinkobjs.push_back(sink);
+    return static_cast<uint32_t>(sinkobjs.size()-1);
+}
+uint32_t FluidSolver::GetEmitGroupCount()
+{
+    uint32_t slots = 0;
+    for(auto& emitter:emitterobjs){
+        slots += emitter.side*emitter.side;
+    }
+    return (slots+ONE_GROUP_INVOCATION_COUNT-1)/ONE_GROUP_INVOCATION_COUNT;
+}
+void FluidSolver::SetRadixsortMode(RadixsortMode mode)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set radixsort mode after vulkan initialized!");
+    }
+    radixsortmode = mode;
+}
+void FluidSolver::SetReorderInterval(uint32_t interval)
+{
+    ReorderInterval = interval;
+}
+void FluidSolver::SetSolverIterations(uint32_t iterations)
+{
+    if(iterations == 0){
+        throw std::runtime_error("solver iterations should be at least 1!");
+    }
+    SolverIterations = iterations;
+    if(Initialized){
+        //the iteration loop is recorded into the simulating command buffers
+        vkQueueWaitIdle(ComputeQueue);
+        vkFreeCommandBuffers(LDevice,CommandPool,static_cast<uint32_t>(SimulatingCommandBuffers.size()),SimulatingCommandBuffers.data());
+        RecordSimulatingCommandBuffers();
+    }
+}
+void FluidSolver::SetSubsteps(uint32_t substeps)
+{
+    if(substeps == 0){
+        throw std::runtime_error("substeps should be at least 1!");
+    }
+    Substeps = substeps;
+    if(Initialized){
+        vkQueueWaitIdle(ComputeQueue);
+        reinterpret_cast<UniformSimulatingObject*>(MappedSimulatingBuffer)->dt = simulatingobj.dt/Substeps;
+    }
+}
+void FluidSolver::SetParticleLayout(ParticleLayout layout)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set particle layout after vulkan initialized!");
+    }
+    particlelayout = layout;
+}
+void FluidSolver::SetCompactDomain(glm::vec3 origin,float extent)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set compact domain after vulkan initialized!");
+    }
+    CompactDomainOrigin = origin;
+    CompactDomainExtent = extent;
+}
+void FluidSolver::SetNeighborMode(NeighborMode mode)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set neighbor mode after vulkan initialized!");
+    }
+    neighbormode = mode;
+}
+void FluidSolver::SetFusedSolver(bool fused)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set fused solver after vulkan initialized!");
+    }
+    bFusedSolver = fused;
+}
+void FluidSolver::SetCellIndexMode(CellIndexMode mode)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set cell index mode after vulkan initialized!");
+    }
+    cellindexmode = mode;
+}
+void FluidSolver::SetCellGrid(glm::vec3 origin,glm::vec3 extent)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set cell grid after vulkan initialized!");
+    }
+    CellGridOrigin = origin;
+    CellGridExtent = extent;
+}
+void FluidSolver::SetNeighborSkin(float skin)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set neighbor skin after vulkan initialized!");
+    }
+    NeighborSkin = skin;
+}
+void FluidSolver::SetProfiling(bool profiling)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set profiling after vulkan initialized!");
+    }
+    bProfiling = profiling;
+}
+FluidSolver::FluidSolver()
+{
+
+}
+FluidSolver::~FluidSolver()
+{
+
+}
+void FluidSolver::Init(const FluidSolverContext& context)
+{
+    PDevice = context.PDevice;
+    LDevice = context.LDevice;
+    ComputeQueue = context.ComputeQueue;
+    ComputeQueueFamily = context.ComputeQueueFamily;
+
+    bool onesweepsupported = IsOnesweepSupported(PDevice);
+    if(radixsortmode == RadixsortMode::AUTO){
+        radixsortmode = onesweepsupported?RadixsortMode::ONESWEEP:RadixsortMode::BLELLOCH;
+    }
+    else if(radixsortmode == RadixsortMode::ONESWEEP && !onesweepsupported){
+        throw std::runtime_error("onesweep radixsort needs subgroup ballot and arithmetic in compute shaders!");
+    }
+    RADIX_SORT_BITS = radixsortmode == RadixsortMode::ONESWEEP?8:4;
+
+    CreateSupportObjects();
+    CreateCommandPool();
+
+    CreateParticleBuffer();
+    CreateParticleNgbrBuffer();
+
+    CreateRadixsortedIndexBuffer();
+    CreateRSGlobalBucketBuffer();
+    CreateCellinfoBuffer();
+    CreateLocalPrefixBuffer();
+    CreateSortKeyBuffer();
+    CreateRSOnesweepBuffer();
+    CreateReorderBuffer();
+    CreateNgbrOffsetBuffer();
+    CreateNgbrInfoBuffer();
+    CreateSolverPositionBuffer();
+    CreateSkinReferenceBuffer();
+
+    CreateUniformNSBuffer();
+    CreateUniformSimulatingBuffer();
+    CreateUniformBoxInfoBuffer();
+    CreateDomainBuffer();
+    CreateParticleCountBuffer();
+    CreateEmitterBuffer();
+    CreateSinkBuffer();
+
+    CreateDescriptorSetLayout();
+    CreateDescriptorPool();
+    CreateDescriptorSet();
+
+    CreateComputePipelineLayout();
+    CreateComputePipeline();
+
+    //a slot per simulating command buffer,then one per reorder command buffer
+    if(bProfiling){
+        Profiler.Init(PDevice,LDevice,ComputeQueueFamily,2*MAXInFlightRendering,context.PipelineStatistics);
+        auto cb = CreateCommandBuffer();
+        Profiler.RecordReset(cb);
+        VkSubmitInfo submitinfo{};
+        SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,ComputeQueue);
+    }
+
+    RecordSimulatingCommandBuffers();
+    RecordReorderCommandBuffers();
+
+    Initialized = true;
+}
+void FluidSolver::Cleanup()
+{
+    if(!Initialized){
+        return;
+    }
+    vkQueueWaitIdle(ComputeQueue);
+
+    vkFreeCommandBuffers(LDevice,CommandPool,MAXInFlightRendering,SimulatingCommandBuffers.data());
+    vkFreeCommandBuffers(LDevice,CommandPool,MAXInFlightRendering,ReorderCommandBuffers.data());
+    Profiler.Cleanup();
+
+    CleanupComputePipeline();
+    vkDestroyPipelineLayout(LDevice,NSPipelineLayout,Allocator);
+    vkDestroyPipelineLayout(LDevice,SimulatePipelineLayout,Allocator);
+
+    vkDestroyDescriptorPool(LDevice,DescriptorPool,Allocator);
+    vkDestroyDescriptorSetLayout(LDevice,SimulateDescriptorSetLayout,Allocator);
+    vkDestroyDescriptorSetLayout(LDevice,NSDescriptorSetLayout,Allocator);
+
+    for(uint32_t i=0;i<MAXInFlightRendering;++i){
+        CleanupBuffer(ParticleBuffers[i],ParticleBufferMemory[i],false);
+    }
+    CleanupBuffer(ParticleNgbrBuffer,ParticleNgbrBufferMemory,false);
+    CleanupBuffer(UniformSimulatingBuffer,UniformSimulatingBufferMemory,true);
+    CleanupBuffer(UniformNSBuffer,UniformNSBufferMemory,true);
+    CleanupBuffer(UniformBoxInfoBuffer,UniformBoxInfoBufferMemory,true);
+    CleanupBuffer(DomainBuffer,DomainBufferMemory,true);
+    CleanupBuffer(ParticleCountBuffer,ParticleCountBufferMemory,false);
+    CleanupBuffer(EmitterBuffer,EmitterBufferMemory,true);
+    CleanupBuffer(SinkBuffer,SinkBufferMemory,true);
+    for(uint32_t i=0;i<2;++i){
+        CleanupBuffer(RadixsortedIndexBuffer[i],RadixsortedIndexBufferMemory[i],false);
+    }
+    CleanupBuffer(RSGlobalBucketBuffer,RSGlobalBucketBufferMemory,false);
+    CleanupBuffer(CellinfoBuffer,CellinfoBufferMemory,false);
+    CleanupBuffer(LocalPrefixBuffer,LocalPrefixBufferMemory,false);
+    for(uint32_t i=0;i<2;++i){
+        CleanupBuffer(SortKeyBuffer[i],SortKeyBufferMemory[i],false);
+    }
+    CleanupBuffer(RSOnesweepBuffer,RSOnesweepBufferMemory,false);
+    CleanupBuffer(ReorderBuffer,ReorderBufferMemory,false);
+    CleanupBuffer(NgbrOffsetBuffer,NgbrOffsetBufferMemory,false);
+    CleanupBuffer(NgbrInfoBuffer,NgbrInfoBufferMemory,true);
+    CleanupBuffer(SolverPositionBuffer,SolverPositionBufferMemory,false);
+    CleanupBuffer(SkinReferenceBuffer,SkinReferenceBufferMemory,false);
+
+    vkDestroyCommandPool(LDevice,CommandPool,Allocator);
+    CleanupSupportObjects();
+    Initialized = false;
+}
+void FluidSolver::CreateSupportObjects()
+{
+    VkSemaphoreCreateInfo seminfo{};
+    seminfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    seminfo.flags = VK_SEMAPHORE_TYPE_BINARY;
+    if(vkCreateSemaphore(LDevice,&seminfo,Allocator,&SimulatingFinish)!=VK_SUCCESS){
+        throw std::runtime_error("failed to create sem:simulatingfinsh!");
+    }
+}
+void FluidSolver::CleanupSupportObjects()
+{
+    vkDestroySemaphore(LDevice,SimulatingFinish,Allocator);
+}
+void FluidSolver::CreateCommandPool()
+{
+    VkCommandPoolCreateInfo createinfo{};
+    createinfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    createinfo.queueFamilyIndex = ComputeQueueFamily;
+    createinfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if(vkCreateCommandPool(LDevice,&createinfo,Allocator,&CommandPool)!=VK_SUCCESS){
+        throw std::runtime_error("failed to create solver command pool!");
+    }
+}
+void FluidSolver::CreateParticleBuffer()
+{
+    //every buffer is sized for the capacity,numParticles is the capacity and the live count sits in ParticleCountBuffer
+    ParticleCapacity = std::max(ParticleCapacity,static_cast<uint32_t>(particles.size()));
+    if(ParticleCapacity%ONE_GROUP_INVOCATION_COUNT != 0){
+        WORK_GROUP_COUNT = ParticleCapacity/ONE_GROUP_INVOCATION_COUNT + 1;
+    }
+    else{
+        WORK_GROUP_COUNT = ParticleCapacity/ONE_GROUP_INVOCATION_COUNT;
+    }
+    nsobject.numParticles = ParticleCapacity;
+    nsobject.workgroup_count = WORK_GROUP_COUNT;
+    SCAN_BLOCK_COUNT = (WORK_GROUP_COUNT+ONE_GROUP_INVOCATION_COUNT-1)/ONE_GROUP_INVOCATION_COUNT;
+    nsobject.hashsize = ParticleCapacity*2;
+    //neighbors are searched out to the skin,the kernels keep cutting off at the simulating radius
+    nsobject.skin = NeighborSkin;
+    nsobject.sphRadius += NeighborSkin;
+    if(cellindexmode != CellIndexMode::HASH){
+        ComputeCellGrid(nsobject.sphRadius);
+    }
+    RADIX_SORT_PASSES = GetRadixsortPasses(nsobject.hashsize);
+
+    simulatingobj.numParticles = ParticleCapacity;
+
+    //the domain rides in the top bits of the id,emitted particles continue the serials
+    uint32_t index = 0;
+    for(uint32_t d=0;d<domainsizes.size();++d){
+        for(uint32_t i=0;i<domainsizes[d];++i,++index){
+            particles[index].Id = (d<<DOMAIN_ID_SHIFT)|index;
+        }
+    }
+
+    ParticleBufferMemory.resize(MAXInFlightRendering);
+    ParticleBuffers.resize(MAXInFlightRendering);
+    VkDeviceSize size = GetParticleBufferSize();
+
+    for(uint32_t i=0;i<MAXInFlightRendering;++i){
+        VkBuffer stagingbuffer;
+        VkDeviceMemory stagingmemory;
+        CreateBuffer(stagingbuffer,stagingmemory,size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        CreateBuffer(ParticleBuffers[i],ParticleBufferMemory[i],size,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT|VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT|VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        void* data;
+        vkMapMemory(LDevice,stagingmemory,0,size,0,&data);
+        PackParticles(data);
+        
+        auto cb = CreateCommandBuffer();
+        VkBufferCopy region{};
+        region.size = size;
+        region.dstOffset = region.srcOffset = 0;
+        vkCmdCopyBuffer(cb,stagingbuffer,ParticleBuffers[i],1,&region);
+        VkSubmitInfo submitinfo{};
+        SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,ComputeQueue);
+        
+        vkDeviceWaitIdle(LDevice);
+        CleanupBuffer(stagingbuffer,stagingmemory,true);
+    }
+}
+
+VkDeviceSize FluidSolver::GetParticleNgbrBufferSize()
+{
+    //the cell walk stores no lists,the descriptors still need a valid buffer behind them
+    if(neighbormode == NeighborMode::CELLWALK){
+        return MAX_NGBR_NUM*sizeof(uint32_t);
+    }
+    if(neighbormode == NeighborMode::COMPACTLIST){
+        return NgbrCapacity*sizeof(uint32_t);
+    }
+    return MAX_NGBR_NUM*ParticleCapacity*sizeof(uint32_t);
+}
+
+void FluidSolver::CreateParticleNgbrBuffer()
+{
+    if(neighbormode == NeighborMode::COMPACTLIST && NgbrCapacity == 0){
+        NgbrCapacity = NGBR_CAPACITY_PER_PARTICLE*ParticleCapacity;
+        nsobject.ngbrcapacity = NgbrCapacity;
+    }
+    VkDeviceSize size = GetParticleNgbrBufferSize();
+    CreateBuffer(ParticleNgbrBuffer,ParticleNgbrBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void FluidSolver::CreateNgbrOffsetBuffer()
+{
+    //offset of every particle's packed list,then the total of every workgroup,then of every block of workgroups
+    VkDeviceSize size = sizeof(uint32_t)*(ParticleCapacity+WORK_GROUP_COUNT+SCAN_BLOCK_COUNT);
+    CreateBuffer(NgbrOffsetBuffer,NgbrOffsetBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void FluidSolver::CreateNgbrInfoBuffer()
+{
+    //largest packed list total seen so far,read back to regrow the list
+    VkDeviceSize size = sizeof(uint32_t);
+    CreateBuffer(NgbrInfoBuffer,NgbrInfoBufferMemory,size,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkMapMemory(LDevice,NgbrInfoBufferMemory,0,size,0,&MappedNgbrInfoBuffer);
+    memset(MappedNgbrInfoBuffer,0,size);
+}
+
+void FluidSolver::CreateSolverPositionBuffer()
+{
+    VkDeviceSize size = sizeof(glm::vec4)*ParticleCapacity;
+    CreateBuffer(SolverPositionBuffer,SolverPositionBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+void FluidSolver::CreateSkinReferenceBuffer()
+{
+    //predicted positions of the last neighbor search,one dummy element keeps the descriptor valid without a skin
+    VkDeviceSize size = sizeof(glm::vec4)*(NeighborSkin>0?ParticleCapacity:1);
+    CreateBuffer(SkinReferenceBuffer,SkinReferenceBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+void FluidSolver::ForceNeighborRebuild()
+{
+    //picked up by ngbrschedule.comp at the next step
+    auto cb = CreateCommandBuffer();
+    vkCmdFillBuffer(cb,ParticleCountBuffer,offsetof(ParticleCountObject,forceRebuild),sizeof(uint32_t),1);
+    VkSubmitInfo submitinfo{};
+    SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,ComputeQueue);
+    vkQueueWaitIdle(ComputeQueue);
+}
+
+void FluidSolver::RegrowParticleNgbrBuffer()
+{
+    //the lists of the step that overflowed were cut short,leave some headroom so this stays rare
+    vkQueueWaitIdle(ComputeQueue);
+    uint32_t required = *reinterpret_cast<uint32_t*>(MappedNgbrInfoBuffer);
+    NgbrCapacity = required + required/4;
+    nsobject.ngbrcapacity = NgbrCapacity;
+    memcpy(MappedNSBuffer,&nsobject,sizeof(UniformNSObject));
+
+    CleanupBuffer(ParticleNgbrBuffer,ParticleNgbrBufferMemory,false);
+    CreateParticleNgbrBuffer();
+    //the new list starts out empty
+    if(nsobject.skin > 0){
+        ForceNeighborRebuild();
+    }
+
+    VkDescriptorBufferInfo ngbrbufferinfo{};
+    ngbrbufferinfo.buffer = ParticleNgbrBuffer;
+    ngbrbufferinfo.offset = 0;
+    ngbrbufferinfo.range = GetParticleNgbrBufferSize();
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.dstArrayElement = 0;
+    write.pBufferInfo = &ngbrbufferinfo;
+    for(uint32_t i=0;i<MAXInFlightRendering;++i){
+        write.dstBinding = 3;
+        write.dstSet = SimulateDescriptorSet[i];
+        vkUpdateDescriptorSets(LDevice,1,&write,0,nullptr);
+        for(uint32_t j=0;j<2;++j){
+            write.dstBinding = 4;
+            write.dstSet = NSDescriptorSets[j][i];
+            vkUpdateDescriptorSets(LDevice,1,&write,0,nullptr);
+        }
+    }
+
+    //the updated sets invalidate every command buffer they are bound in
+    vkFreeCommandBuffers(LDevice,CommandPool,static_cast<uint32_t>(SimulatingCommandBuffers.size()),SimulatingCommandBuffers.data());
+    RecordSimulatingCommandBuffers();
+    vkFreeCommandBuffers(LDevice,CommandPool,static_cast<uint32_t>(ReorderCommandBuffers.size()),ReorderCommandBuffers.data());
+    RecordReorderCommandBuffers();
+}
+
+void FluidSolver::CreateUniformSimulatingBuffer()
+{
+    VkDeviceSize size = sizeof(UniformSimulatingObject);
+    CreateBuffer(UniformSimulatingBuffer,UniformSimulatingBufferMemory,size,
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkMapMemory(LDevice,UniformSimulatingBufferMemory,0,size,0,&MappedSimulatingBuffer);
+    memcpy(MappedSimulatingBuffer,&simulatingobj,size);
+    reinterpret_cast<UniformSimulatingObject*>(MappedSimulatingBuffer)->dt = simulatingobj.dt/Substeps;
+}
+
+void FluidSolver::CreateUniformNSBuffer()
+{
+    VkDeviceSize size = sizeof(UniformNSObject);
+    CreateBuffer(UniformNSBuffer,UniformNSBufferMemory,size,
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkMapMemory(LDevice,UniformNSBufferMemory,0,size,0,&MappedNSBuffer);
+    memcpy(MappedNSBuffer,&nsobject,size);
+}
+
+void FluidSolver::CreateUniformBoxInfoBuffer()
+{
+    //one box per domain,the presentation layer only reads the first
+    VkDeviceSize size = sizeof(UniformBoxInfoObject)*MAX_FLUID_DOMAINS;
+    CreateBuffer(UniformBoxInfoBuffer,UniformBoxInfoBufferMemory,size,
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkMapMemory(LDevice,UniformBoxInfoBufferMemory,0,size,0,&MappedBoxInfoBuffer);
+    memset(MappedBoxInfoBuffer,0,size);
+    memcpy(MappedBoxInfoBuffer,boxinfobjs.data(),sizeof(UniformBoxInfoObject)*boxinfobjs.size());
+}
+void FluidSolver::CreateDomainBuffer()
+{
+    domainobjs[0].restDensity = simulatingobj.restDensity;
+    domainobjs[0].scorrK = simulatingobj.scorrK;
+    domainobjs[0].scorrN = simulatingobj.scorrN;
+    domainobjs[0].scorrQ = simulatingobj.scorrQ;
+
+    VkDeviceSize size = sizeof(FluidDomainObject)*domainobjs.size();
+    CreateBuffer(DomainBuffer,DomainBufferMemory,size,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkMapMemory(LDevice,DomainBufferMemory,0,size,0,&MappedDomainBuffer);
+    memcpy(MappedDomainBuffer,domainobjs.data(),size);
+}
+void FluidSolver::CreateParticleCountBuffer()
+{
+    ParticleCountObject count{};
+    count.liveParticles = static_cast<uint32_t>(particles.size());
+    count.groupCountX = (count.liveParticles+ONE_GROUP_INVOCATION_COUNT-1)/ONE_GROUP_INVOCATION_COUNT;
+    count.groupCountY = 1;
+    count.groupCountZ = 1;
+    count.instanceCount = 1;
+    count.nextSerial = count.liveParticles;
+    count.forceRebuild = 1;
+
+    VkDeviceSize size = sizeof(ParticleCountObject);
+    VkBuffer stagingbuffer;
+    VkDeviceMemory stagingmemory;
+    CreateBuffer(stagingbuffer,stagingmemory,size,
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    CreateBuffer(ParticleCountBuffer,ParticleCountBufferMemory,size,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_SRC_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    void* data;
+    vkMapMemory(LDevice,stagingmemory,0,size,0,&data);
+    memcpy(data,&count,size);
+
+    auto cb = CreateCommandBuffer();
+    VkBufferCopy region{};
+    region.size = size;
+    region.dstOffset = region.srcOffset = 0;
+    vkCmdCopyBuffer(cb,stagingbuffer,ParticleCountBuffer,1,&region);
+    VkSubmitInfo submitinfo{};
+    SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,ComputeQueue);
+
+    vkDeviceWaitIdle(LDevice);
+    CleanupBuffer(stagingbuffer,stagingmemory,true);
+}
+void FluidSolver::CreateEmitterBuffer()
+{
+    //the descriptor needs a buffer behind it,a lone side 0 emitter never emits
+    std::vector<ParticleEmitterObject> emitters = emitterobjs;
+    if(emitters.empty()){
+        emitters.push_back(ParticleEmitterObject{});
+    }
+    VkDeviceSize size = sizeof(ParticleEmitterObject)*emitters.size();
+    CreateBuffer(EmitterBuffer,EmitterBufferMemory,size,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkMapMemory(LDevice,EmitterBufferMemory,0,size,0,&MappedEmitterBuffer);
+    memcpy(MappedEmitterBuffer,emitters.data(),size);
+}
+void FluidSolver::CreateSinkBuffer()
+{
+    //same as the emitters,an inverted box drains nothing
+    std::vector<ParticleSinkObject> sinks = sinkobjs;
+    if(sinks.empty()){
+        sinks.push_back(ParticleSinkObject{glm::vec3(1e30f),glm::vec3(-1e30f)});
+    }
+    VkDeviceSize size = sizeof(ParticleSinkObject)*sinks.size();
+    CreateBuffer(SinkBuffer,SinkBufferMemory,size,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkMapMemory(LDevice,SinkBufferMemory,0,size,0,&MappedSinkBuffer);
+    memcpy(MappedSinkBuffer,sinks.data(),size);
+}
+
+void FluidSolver::CreateRadixsortedIndexBuffer()
+{
+    VkDeviceSize size = sizeof(uint32_t)*ParticleCapacity;
+    for(uint32_t i=0;i<2;++i){
+        VkBuffer stagingbuffer;
+        VkDeviceMemory stagingmemory;
+        CreateBuffer(stagingbuffer,stagingmemory,size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        CreateBuffer(RadixsortedIndexBuffer[i],RadixsortedIndexBufferMemory[i],size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        void* data;
+        vkMapMemory(LDevice,stagingmemory,0,size,0,&data);
+        int* intdata = reinterpret_cast<int*>(data);
+        for(uint32_t j=0;j<size/4;++j)
+        {
+            intdata[j] = j;
+        }
+        
+        auto cb = CreateCommandBuffer();
+        VkBufferCopy region{};
+        region.size = size;
+        region.dstOffset = region.srcOffset = 0;
+        vkCmdCopyBuffer(cb,stagingbuffer,RadixsortedIndexBuffer[i],1,&region);
+        VkSubmitInfo submitinfo{};
+        SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,ComputeQueue);
+        
+        vkDeviceWaitIdle(LDevice);
+        CleanupBuffer(stagingbuffer,stagingmemory,true);
+    }
+}
+
+void FluidSolver::CreateRSGlobalBucketBuffer()
+{
+    //bucket counts of every workgroup,the digit totals,then the totals of every block of workgroups
+    VkDeviceSize size = sizeof(uint32_t)*(WORK_GROUP_COUNT+1+SCAN_BLOCK_COUNT)*16;
+    CreateBuffer(RSGlobalBucketBuffer,RSGlobalBucketBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void FluidSolver::ComputeCellGrid(float radius)
+{
+    glm::vec3 lo = CellGridOrigin;
+    glm::vec3 hi = CellGridOrigin+CellGridExtent;
+    if(CellGridExtent == glm::vec3(0.0f)){
+        //both the moving and the still walls of every domain,particles beyond them share the border cells
+        lo = glm::vec3(std::numeric_limits<float>::max());
+        hi = glm::vec3(std::numeric_limits<float>::lowest());
+        for(auto& box:boxinfobjs){
+            glm::vec3 boxlo = glm::min(glm::vec3(box.clampX.x,box.clampY.x,box.clampZ.x),glm::vec3(box.clampX_still.x,box.clampY_still.x,box.clampZ_still.x));
+            glm::vec3 boxhi = glm::max(glm::vec3(box.clampX.y,box.clampY.y,box.clampZ.y),glm::vec3(box.clampX_still.y,box.clampY_still.y,box.clampZ_still.y));
+            lo = glm::min(lo,boxlo);
+            hi = glm::max(hi,boxhi);
+        }
+    }
+    if(radius <= 0.0f || glm::any(glm::lessThan(hi,lo))){
+        throw std::runtime_error("dense cell grid needs sphRadius and a bounded box!");
+    }
+    //nothing is kept until the grid is known to fit
+    glm::ivec3 gridmin = glm::ivec3(glm::floor(lo/radius));
+    glm::ivec3 cellmax = glm::ivec3(glm::floor(hi/radius));
+    glm::uvec3 griddim = glm::uvec3(cellmax-gridmin+1);
+
+    uint64_t cells = uint64_t(griddim.x)*griddim.y*griddim.z;
+    if(cellindexmode == CellIndexMode::MORTON){
+        //10 bits per axis
+        uint32_t side = std::bit_ceil(std::max({griddim.x,griddim.y,griddim.z}));
+        if(side > 1024){
+            throw std::runtime_error("cell grid is too big for morton order!");
+        }
+        cells = uint64_t(side)*side*side;
+    }
+    cells *= domainobjs.size();
+    if(cells >= (1ull<<31)){
+        throw std::runtime_error("cell grid is too big!");
+    }
+    CellGridMin = gridmin;
+    CellGridDim = griddim;
+    nsobject.hashsize = static_cast<uint32_t>(cells);
+}
+VkDeviceSize FluidSolver::GetCellinfoBufferSize()
+{
+    //begin and end of every bucket of the hash table or cell of the dense grid
+    return sizeof(uint32_t)*2*CellinfoCapacity;
+}
+void FluidSolver::CreateCellinfoBuffer()
+{
+    //cleared by a transfer fill every step,see RecordSimulatingCommandBuffers
+    CellinfoCapacity = nsobject.hashsize;
+    VkDeviceSize size = GetCellinfoBufferSize();
+    CreateBuffer(CellinfoBuffer,CellinfoBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+void FluidSolver::RegrowCellBuffers()
+{
+    //the queue is idle,every set binding the cell table is rewritten and the caller records again
+    CleanupBuffer(CellinfoBuffer,CellinfoBufferMemory,false);
+    CreateCellinfoBuffer();
+    if(radixsortmode == RadixsortMode::COUNTING){
+        CleanupBuffer(RSOnesweepBuffer,RSOnesweepBufferMemory,false);
+        CreateRSOnesweepBuffer();
+    }
+
+    VkDescriptorBufferInfo cellinfobufferinfo{};
+    cellinfobufferinfo.buffer = CellinfoBuffer;
+    cellinfobufferinfo.offset = 0;
+    cellinfobufferinfo.range = GetCellinfoBufferSize();
+    VkDescriptorBufferInfo onesweepbufferinfo{};
+    onesweepbufferinfo.buffer = RSOnesweepBuffer;
+    onesweepbufferinfo.offset = 0;
+    onesweepbufferinfo.range = VK_WHOLE_SIZE;
+    std::array<VkWriteDescriptorSet,2> writes{};
+    for(auto& write:writes){
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.dstArrayElement = 0;
+    }
+    writes[0].dstBinding = 6;
+    writes[0].pBufferInfo = &cellinfobufferinfo;
+    writes[1].dstBinding = 10;
+    writes[1].pBufferInfo = &onesweepbufferinfo;
+    for(uint32_t i=0;i<MAXInFlightRendering;++i){
+        for(uint32_t j=0;j<2;++j){
+            writes[0].dstSet = writes[1].dstSet = NSDescriptorSets[j][i];
+            vkUpdateDescriptorSets(LDevice,static_cast<uint32_t>(writes.size()),writes.data(),0,nullptr);
+        }
+    }
+    WriteSimulateNeighborDescriptors();
+}
+
+void FluidSolver::CreateLocalPrefixBuffer()
+{
+    //rank of every key among the keys of its digit inside its workgroup
+    VkDeviceSize size = sizeof(uint32_t)*ParticleCapacity;
+    CreateBuffer(LocalPrefixBuffer,LocalPrefixBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void FluidSolver::CreateSortKeyBuffer()
+{
+    VkDeviceSize size = sizeof(uint32_t)*ParticleCapacity;
+    for(uint32_t i=0;i<2;++i){
+        CreateBuffer(SortKeyBuffer[i],SortKeyBufferMemory[i],size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+}
+
+void FluidSolver::CreateRSOnesweepBuffer()
+{
+    //global histogram of every pass,partition ticket,then look-back status of every pass and partition
+    //status is sized for a full 32-bit key so a larger hashsize later needs no reallocation
+    VkDeviceSize size = sizeof(uint32_t)*ONESWEEP_STATUS_OFFSET;
+    if(radixsortmode == RadixsortMode::ONESWEEP){
+        size += sizeof(uint32_t)*(32/RADIX_SORT_BITS)*WORK_GROUP_COUNT*256;
+    }
+    //the counting sort only looks back over the cell scan blocks,sized with the cell table
+    else if(radixsortmode == RadixsortMode::COUNTING){
+        size += sizeof(uint32_t)*((CellinfoCapacity+CELL_SCAN_CELLS_PER_BLOCK-1)/CELL_SCAN_CELLS_PER_BLOCK);
+    }
+    CreateBuffer(RSOnesweepBuffer,RSOnesweepBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+VkDeviceSize FluidSolver::GetParticleBufferSize()
+{
+    if(particlelayout == ParticleLayout::SOA){
+        return sizeof(glm::vec4)*PARTICLE_SOA_STREAMS*ParticleCapacity;
+    }
+    if(particlelayout == ParticleLayout::COMPACT){
+        return 2*sizeof(uint32_t)*PARTICLE_COMPACT_STREAMS*ParticleCapacity;
+    }
+    return sizeof(Particle)*ParticleCapacity;
+}
+
+void FluidSolver::PackSOAParticles(void* dst)
+{
+    //same stream order as particle.glsl,streams are capacity long
+    size_t n = ParticleCapacity;
+    auto streams = reinterpret_cast<glm::vec4*>(dst);
+    auto bits = reinterpret_cast<glm::uvec4*>(dst);
+    for(size_t i=0;i<particles.size();++i){
+        const Particle& p = particles[i];
+        streams[i] = glm::vec4(p.Location,p.Mass);
+        streams[n+i] = glm::vec4(p.Velocity,p.Density);
+        streams[2*n+i] = glm::vec4(p.DeltaLocation,p.Lambda);
+        streams[3*n+i] = glm::vec4(p.TmpVelocity,0);
+        bits[4*n+i] = glm::uvec4(p.CellHash,p.TmpCellHash,p.NumNgbrs,p.Id);
+    }
+}
+
+//helpers mirroring the compact layout of particle.glsl
+static const float COMPACT_FIXED_MAX = 2097151.0f;
+static const float COMPACT_LAMBDA_SCALE = 4096.0f;
+static uint32_t PackHalf2(float a,float b)
+{
+    return HelperFuncs::FloatToHalf(a)|(static_cast<uint32_t>(HelperFuncs::FloatToHalf(b))<<16);
+}
+static void PackHalf4(uint32_t* dst,glm::vec3 v,float w)
+{
+    dst[0] = PackHalf2(v.x,v.y);
+    dst[1] = PackHalf2(v.z,w);
+}
+static glm::vec3 UnpackHalf4(const uint32_t* src,float& w)
+{
+    w = HelperFuncs::HalfToFloat(src[1]>>16);
+    return glm::vec3(HelperFuncs::HalfToFloat(src[0]&0xFFFF),HelperFuncs::HalfToFloat(src[0]>>16),HelperFuncs::HalfToFloat(src[1]&0xFFFF));
+}
+
+void FluidSolver::PackParticles(void* dst)
+{
+    if(particlelayout == ParticleLayout::AOS){
+        memcpy(dst,particles.data(),sizeof(Particle)*particles.size());
+        return;
+    }
+    if(particlelayout == ParticleLayout::SOA){
+        PackSOAParticles(dst);
+        return;
+    }
+    size_t n = ParticleCapacity;
+    auto streams = reinterpret_cast<uint32_t*>(dst);
+    for(size_t i=0;i<particles.size();++i){
+        const Particle& p = particles[i];
+        uint32_t q[3];
+        for(uint32_t axis=0;axis<3;++axis){
+            float t = std::clamp((p.Location[axis]-CompactDomainOrigin[axis])/CompactDomainExtent,0.0f,1.0f);
+            q[axis] = static_cast<uint32_t>(t*COMPACT_FIXED_MAX+0.5f);
+        }
+        streams[2*i] = q[0]|(q[1]<<21);
+        streams[2*i+1] = q[2]|((q[1]>>11)<<21);
+        PackHalf4(&streams[2*(n+i)],p.Velocity,p.Density/simulatingobj.restDensity);
+        PackHalf4(&streams[2*(2*n+i)],p.DeltaLocation,p.Lambda*COMPACT_LAMBDA_SCALE);
+        PackHalf4(&streams[2*(3*n+i)],p.TmpVelocity,p.Mass);
+        streams[2*(4*n+i)] = p.CellHash;
+        streams[2*(4*n+i)+1] = p.TmpCellHash;
+        streams[2*(5*n+i)] = p.NumNgbrs;
+        streams[2*(5*n+i)+1] = p.Id;
+    }
+}
+
+void FluidSolver::UnpackParticles(const void* src,uint32_t count,std::vector<Particle>& ps)
+{
+    size_t n = ParticleCapacity;
+    ps.resize(count);
+    if(particlelayout == ParticleLayout::AOS){
+        memcpy(ps.data(),src,sizeof(Particle)*count);
+        return;
+    }
+    if(particlelayout == ParticleLayout::SOA){
+        auto streams = reinterpret_cast<const glm::vec4*>(src);
+        auto bits = reinterpret_cast<const glm::uvec4*>(src);
+        for(size_t i=0;i<count;++i){
+            Particle& p = ps[i];
+            p.Location = glm::vec3(streams[i].x,streams[i].y,streams[i].z);
+            p.Mass = streams[i].w;
+            p.Velocity = glm::vec3(streams[n+i].x,streams[n+i].y,streams[n+i].z);
+            p.Density = streams[n+i].w;
+            p.DeltaLocation = glm::vec3(streams[2*n+i].x,streams[2*n+i].y,streams[2*n+i].z);
+            p.Lambda = streams[2*n+i].w;
+            p.TmpVelocity = glm::vec3(streams[3*n+i].x,streams[3*n+i].y,streams[3*n+i].z);
+            p.CellHash = bits[4*n+i].x;
+            p.TmpCellHash = bits[4*n+i].y;
+            p.NumNgbrs = bits[4*n+i].z;
+            p.Id = bits[4*n+i].w;
+        }
+        return;
+    }
+    auto streams = reinterpret_cast<const uint32_t*>(src);
+    for(size_t i=0;i<count;++i){
+        Particle& p = ps[i];
+        uint32_t q[3] = {streams[2*i]&0x1FFFFF,(streams[2*i]>>21)|((streams[2*i+1]>>21)<<11),streams[2*i+1]&0x1FFFFF};
+        for(uint32_t axis=0;axis<3;++axis){
+            p.Location[axis] = CompactDomainOrigin[axis] + q[axis]/COMPACT_FIXED_MAX*CompactDomainExtent;
+        }
+        p.Velocity = UnpackHalf4(&streams[2*(n+i)],p.Density);
+        p.Density *= simulatingobj.restDensity;
+        p.DeltaLocation = UnpackHalf4(&streams[2*(2*n+i)],p.Lambda);
+        p.Lambda /= COMPACT_LAMBDA_SCALE;
+        p.TmpVelocity = UnpackHalf4(&streams[2*(3*n+i)],p.Mass);
+        p.CellHash = streams[2*(4*n+i)];
+        p.TmpCellHash = streams[2*(4*n+i)+1];
+        p.NumNgbrs = streams[2*(5*n+i)];
+        p.Id = streams[2*(5*n+i)+1];
+    }
+}
+
+uint32_t FluidSolver::GetParticleCount()
+{
+    return ReadParticleCountObject().liveParticles;
+}
+uint32_t FluidSolver::GetNeighborRebuildCount()
+{
+    //without a skin the neighbor search runs unconditionally and ngbrschedule.comp never counts
+    if(nsobject.skin <= 0){
+        return SimulatedSteps;
+    }
+    return ReadParticleCountObject().rebuildCount;
+}
+ParticleCountObject FluidSolver::ReadParticleCountObject()
+{
+    vkQueueWaitIdle(ComputeQueue);
+
+    VkBuffer stagingbuffer;
+    VkDeviceMemory stagingmemory;
+    CreateBuffer(stagingbuffer,stagingmemory,sizeof(ParticleCountObject),
+    VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    auto cb = CreateCommandBuffer();
+    VkBufferCopy region{};
+    region.size = sizeof(ParticleCountObject);
+    region.dstOffset = region.srcOffset = 0;
+    vkCmdCopyBuffer(cb,ParticleCountBuffer,stagingbuffer,1,&region);
+    VkSubmitInfo submitinfo{};
+    SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,ComputeQueue);
+    vkQueueWaitIdle(ComputeQueue);
+
+    void* data;
+    vkMapMemory(LDevice,stagingmemory,0,sizeof(ParticleCountObject),0,&data);
+    ParticleCountObject count = *reinterpret_cast<ParticleCountObject*>(data);
+    CleanupBuffer(stagingbuffer,stagingmemory,true);
+    return count;
+}
+void FluidSolver::GetParticles(std::vector<Particle>& ps)
+{
+    uint32_t count = GetParticleCount();
+
+    VkDeviceSize size = GetParticleBufferSize();
+    VkBuffer stagingbuffer;
+    VkDeviceMemory stagingmemory;
+    CreateBuffer(stagingbuffer,stagingmemory,size,
+    VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    auto cb = CreateCommandBuffer();
+    VkBufferCopy region{};
+    region.size = size;
+    region.dstOffset = region.srcOffset = 0;
+    vkCmdCopyBuffer(cb,ParticleBuffers[CurrentFlight],stagingbuffer,1,&region);
+    VkSubmitInfo submitinfo{};
+    SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,ComputeQueue);
+    vkQueueWaitIdle(ComputeQueue);
+
+    void* data;
+    vkMapMemory(LDevice,stagingmemory,0,size,0,&data);
+    UnpackParticles(data,count,ps);
+    CleanupBuffer(stagingbuffer,stagingmemory,true);
+
+    //slots may have been reordered,emitted into or drained on the gpu,hand them back in upload order
+    //ids grow with the domain first,so every domain comes back in one piece
+    std::sort(ps.begin(),ps.end(),[](const Particle& a,const Particle& b){ return a.Id<b.Id; });
+}
+
+void FluidSolver::CreateReorderBuffer()
+{
+    VkDeviceSize size = GetParticleBufferSize();
+    CreateBuffer(ReorderBuffer,ReorderBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+void FluidSolver::CreateDescriptorSetLayout()
+{
+    {
+        std::array<VkDescriptorSetLayoutBinding,12> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorCount = 1;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[1].binding = 1;
+        bindings[1].descriptorCount = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[2].binding = 2;
+        bindings[2].descriptorCount = 1;
+        bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[3].binding = 3;
+        bindings[3].descriptorCount = 1;
+        bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[3].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[4].binding = 4;
+        bindings[4].descriptorCount = 1;
+        bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        //cellinfo,sorted index,ns object and packed list offsets,see neighbor.glsl
+        bindings[5].binding = 5;
+        bindings[5].descriptorCount = 1;
+        bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[5].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[6].binding = 6;
+        bindings[6].descriptorCount = 1;
+        bindings[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[6].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[7].binding = 7;
+        bindings[7].descriptorCount = 1;
+        bindings[7].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[7].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[8].binding = 8;
+        bindings[8].descriptorCount = 1;
+        bindings[8].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[8].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        //jacobi positions of the fused solver,see solver.glsl
+        bindings[9].binding = 9;
+        bindings[9].descriptorCount = 1;
+        bindings[9].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[9].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        //domain table,see domain.glsl
+        bindings[10].binding = 10;
+        bindings[10].descriptorCount = 1;
+        bindings[10].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[10].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        //live particle count,see count.glsl
+        bindings[11].binding = 11;
+        bindings[11].descriptorCount = 1;
+        bindings[11].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[11].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo createinfo{};
+        createinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        createinfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        createinfo.pBindings = bindings.data();
+
+        if(vkCreateDescriptorSetLayout(LDevice,&createinfo,Allocator,&SimulateDescriptorSetLayout)!=VK_SUCCESS){
+            throw std::runtime_error("failed to create simulate descriptor set layout!");
+        }
+    }
+    {
+        std::array<VkDescriptorSetLayoutBinding,19> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorCount = 1;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[1].binding = 1;
+        bindings[1].descriptorCount = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[2].binding = 2;
+        bindings[2].descriptorCount = 1;
+        bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[3].binding = 3;
+        bindings[3].descriptorCount = 1;
+        bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[3].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[4].binding = 4;
+        bindings[4].descriptorCount = 1;
+        bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[5].binding = 5;
+        bindings[5].descriptorCount = 1;
+        bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[5].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[6].binding = 6;
+        bindings[6].descriptorCount = 1;
+        bindings[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[6].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[7].binding = 7;
+        bindings[7].descriptorCount = 1;
+        bindings[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[7].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[8].binding = 8;
+        bindings[8].descriptorCount = 1;
+        bindings[8].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[8].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[9].binding = 9;
+        bindings[9].descriptorCount = 1;
+        bindings[9].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[9].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[10].binding = 10;
+        bindings[10].descriptorCount = 1;
+        bindings[10].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[10].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[11].binding = 11;
+        bindings[11].descriptorCount = 1;
+        bindings[11].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[11].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[12].binding = 12;
+        bindings[12].descriptorCount = 1;
+        bindings[12].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[12].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[13].binding = 13;
+        bindings[13].descriptorCount = 1;
+        bindings[13].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[13].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[14].binding = 14;
+        bindings[14].descriptorCount = 1;
+        bindings[14].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[14].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        //live particle count,emitters and sinks
+        bindings[15].binding = 15;
+        bindings[15].descriptorCount = 1;
+        bindings[15].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[15].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[16].binding = 16;
+        bindings[16].descriptorCount = 1;
+        bindings[16].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[16].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[17].binding = 17;
+        bindings[17].descriptorCount = 1;
+        bindings[17].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[17].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings[18].binding = 18;
+        bindings[18].descriptorCount = 1;
+        bindings[18].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[18].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo createinfo{};
+        createinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        createinfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        createinfo.pBindings = bindings.data();
+        if(vkCreateDescriptorSetLayout(LDevice,&createinfo,Allocator,&NSDescriptorSetLayout)!=VK_SUCCESS){
+            throw std::runtime_error("failed to create neighborhood searcher descriptor set layout!");
+        }
+
+    }
+}
+void FluidSolver::CreateDescriptorPool()
+{
+    //two simulate sets and four neighborhood searcher sets
+    std::array<VkDescriptorPoolSize,2> poolsizes{};
+    poolsizes[0].descriptorCount = 16;
+    poolsizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolsizes[1].descriptorCount = 128;
+    poolsizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+    VkDescriptorPoolCreateInfo createinfo{};
+    createinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    createinfo.maxSets = 8;
+    createinfo.poolSizeCount = static_cast<uint32_t>(poolsizes.size());
+    createinfo.pPoolSizes = poolsizes.data();
+
+    if(vkCreateDescriptorPool(LDevice,&createinfo,Allocator,&DescriptorPool)!=VK_SUCCESS){
+        throw std::runtime_error("failed to create solver descriptor pool!");
+    }
+}
+void FluidSolver::WriteSimulateNeighborDescriptors()
+{
+    //the sorted index lives in the buffer the last radix sort pass wrote,which moves with the pass count
+    std::array<VkWriteDescriptorSet,4> writes{};
+
+    VkDescriptorBufferInfo cellinfobufferinfo{};
+    cellinfobufferinfo.buffer = CellinfoBuffer;
+    cellinfobufferinfo.offset = 0;
+    cellinfobufferinfo.range = GetCellinfoBufferSize();
+
+    VkDescriptorBufferInfo sortedidxbufferinfo{};
+    sortedidxbufferinfo.buffer = RadixsortedIndexBuffer[RADIX_SORT_PASSES%2];
+    sortedidxbufferinfo.offset = 0;
+    sortedidxbufferinfo.range = sizeof(uint32_t)*ParticleCapacity;
+
+    VkDescriptorBufferInfo nsbufferinfo{};
+    nsbufferinfo.buffer = UniformNSBuffer;
+    nsbufferinfo.offset = 0;
+    nsbufferinfo.range = sizeof(UniformNSObject);
+
+    VkDescriptorBufferInfo ngbroffsetbufferinfo{};
+    ngbroffsetbufferinfo.buffer = NgbrOffsetBuffer;
+    ngbroffsetbufferinfo.offset = 0;
+    ngbroffsetbufferinfo.range = sizeof(uint32_t)*(ParticleCapacity+WORK_GROUP_COUNT+SCAN_BLOCK_COUNT);
+
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[0].dstArrayElement = 0;
+    writes[0].dstBinding = 5;
+    writes[0].pBufferInfo = &cellinfobufferinfo;
+
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[1].dstArrayElement = 0;
+    writes[1].dstBinding = 6;
+    writes[1].pBufferInfo = &sortedidxbufferinfo;
+
+    writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[2].descriptorCount = 1;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[2].dstArrayElement = 0;
+    writes[2].dstBinding = 7;
+    writes[2].pBufferInfo = &nsbufferinfo;
+
+    writes[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[3].descriptorCount = 1;
+    writes[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[3].dstArrayElement = 0;
+    writes[3].dstBinding = 8;
+    writes[3].pBufferInfo = &ngbroffsetbufferinfo;
+
+    for(uint32_t i=0;i<MAXInFlightRendering;++i){
+        for(auto& write : writes){
+            write.dstSet = SimulateDescriptorSet[i];
+        }
+        vkUpdateDescriptorSets(LDevice,writes.size(),writes.data(),0,nullptr);
+    }
+}
+void FluidSolver::CreateDescriptorSet()
+{
+    {
+        SimulateDescriptorSet.resize(MAXInFlightRendering);
+        VkDescriptorSetAllocateInfo allocateinfo{};
+        allocateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateinfo.descriptorPool = DescriptorPool;
+        allocateinfo.descriptorSetCount = 1;
+        allocateinfo.pSetLayouts = &SimulateDescriptorSetLayout;
+        for(uint32_t i=0;i<MAXInFlightRendering;++i){
+            if(vkAllocateDescriptorSets(LDevice,&allocateinfo,&SimulateDescriptorSet[i])!=VK_SUCCESS){
+                throw std::runtime_error("failed to allocate simulate descriptor set!");
+            }
+        }
+        std::array<VkWriteDescriptorSet,8> writes{};
+
+        VkDescriptorBufferInfo simulatingbufferinfo{};
+        simulatingbufferinfo.buffer = UniformSimulatingBuffer;
+        simulatingbufferinfo.offset = 0;
+        simulatingbufferinfo.range = sizeof(UniformSimulatingObject);
+
+        VkDescriptorBufferInfo ngbrbufferinfo{};
+        ngbrbufferinfo.buffer = ParticleNgbrBuffer;
+        ngbrbufferinfo.offset = 0;
+        ngbrbufferinfo.range = GetParticleNgbrBufferSize();
+
+        VkDescriptorBufferInfo boxbufferinfo{};
+        boxbufferinfo.buffer = UniformBoxInfoBuffer;
+        boxbufferinfo.offset = 0;
+        boxbufferinfo.range = sizeof(UniformBoxInfoObject)*MAX_FLUID_DOMAINS;
+
+        VkDescriptorBufferInfo domainbufferinfo{};
+        domainbufferinfo.buffer = DomainBuffer;
+        domainbufferinfo.offset = 0;
+        domainbufferinfo.range = sizeof(FluidDomainObject)*domainobjs.size();
+
+        VkDescriptorBufferInfo solverpositionbufferinfo{};
+        solverpositionbufferinfo.buffer = SolverPositionBuffer;
+        solverpositionbufferinfo.offset = 0;
+        solverpositionbufferinfo.range = sizeof(glm::vec4)*ParticleCapacity;
+
+        VkDescriptorBufferInfo countbufferinfo{};
+        countbufferinfo.buffer = ParticleCountBuffer;
+        countbufferinfo.offset = 0;
+        countbufferinfo.range = sizeof(ParticleCountObject);
+        
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[0].dstArrayElement = 0;
+        writes[0].dstBinding = 0;
+        writes[0].pBufferInfo = &simulatingbufferinfo;
+            
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[1].dstArrayElement = 0;
+        writes[1].dstBinding = 1;
+
+        writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[2].descriptorCount = 1;
+        writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[2].dstArrayElement = 0;
+        writes[2].dstBinding = 2; 
+
+        writes[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[3].descriptorCount = 1;
+        writes[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[3].dstArrayElement = 0;
+        writes[3].dstBinding = 3;
+        writes[3].pBufferInfo = &ngbrbufferinfo;
+
+        writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[4].descriptorCount = 1;
+        writes[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[4].dstArrayElement = 0;
+        writes[4].dstBinding = 4;
+        writes[4].pBufferInfo = &boxbufferinfo;
+
+        writes[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[5].descriptorCount = 1;
+        writes[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[5].dstArrayElement = 0;
+        writes[5].dstBinding = 9;
+        writes[5].pBufferInfo = &solverpositionbufferinfo;
+
+        writes[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[6].descriptorCount = 1;
+        writes[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[6].dstArrayElement = 0;
+        writes[6].dstBinding = 10;
+        writes[6].pBufferInfo = &domainbufferinfo;
+
+        writes[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[7].descriptorCount = 1;
+        writes[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[7].dstArrayElement = 0;
+        writes[7].dstBinding = 11;
+        writes[7].pBufferInfo = &countbufferinfo;
+
+    
+
+        for(uint32_t i=0;i<MAXInFlightRendering;++i){
+           
+            VkDescriptorBufferInfo particlebufferinfo_thisframe{};
+            particlebufferinfo_thisframe.buffer = ParticleBuffers[i];
+            particlebufferinfo_thisframe.offset = 0;
+            particlebufferinfo_thisframe.range = GetParticleBufferSize();
+            VkDescriptorBufferInfo particlebufferinfo_lastframe{};
+            particlebufferinfo_lastframe.buffer = ParticleBuffers[(i-1)%MAXInFlightRendering];
+            particlebufferinfo_lastframe.offset = 0;
+            particlebufferinfo_lastframe.range = GetParticleBufferSize();
+            
+            writes[0].dstSet = SimulateDescriptorSet[i];
+            writes[1].dstSet = SimulateDescriptorSet[i];
+            writes[1].pBufferInfo = &particlebufferinfo_lastframe;
+            writes[2].dstSet = SimulateDescriptorSet[i];
+            writes[2].pBufferInfo =  &particlebufferinfo_thisframe;
+            writes[3].dstSet = SimulateDescriptorSet[i];
+            writes[4].dstSet = SimulateDescriptorSet[i];
+            writes[5].dstSet = SimulateDescriptorSet[i];
+            writes[6].dstSet = SimulateDescriptorSet[i];
+            writes[7].dstSet = SimulateDescriptorSet[i];
+            
+            vkUpdateDescriptorSets(LDevice,writes.size(),writes.data(),0,nullptr);
+        }
+        WriteSimulateNeighborDescriptors();
+    }
+    {
+        for(uint32_t i=0;i<2;++i){
+            NSDescriptorSets[i].resize(MAXInFlightRendering);
+        }
+        for(uint32_t i=0;i<2;++i){
+            for(uint32_t j=0;j<MAXInFlightRendering;++j){
+                VkDescriptorSetAllocateInfo allocateinfo{};
+                allocateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+                allocateinfo.descriptorSetCount = 1;
+                allocateinfo.descriptorPool = DescriptorPool;
+                allocateinfo.pSetLayouts = &NSDescriptorSetLayout;
+                if(vkAllocateDescriptorSets(LDevice,&allocateinfo,&NSDescriptorSets[i][j])!=VK_SUCCESS){
+                    throw std::runtime_error("failed to allocate neighborhood searcher desciptorset!");
+                }
+            }
+        }
+
+        VkDescriptorBufferInfo nsbufferinfo{};
+        nsbufferinfo.buffer = UniformNSBuffer;
+        nsbufferinfo.offset = 0;
+        nsbufferinfo.range = sizeof(UniformNSObject);
+
+        VkDescriptorBufferInfo sortedidxbufferinfo[2]{};
+        sortedidxbufferinfo[0].buffer = RadixsortedIndexBuffer[0];
+        sortedidxbufferinfo[0].offset = 0;
+        sortedidxbufferinfo[0].range = sizeof(uint32_t)*ParticleCapacity;
+        sortedidxbufferinfo[1].buffer = RadixsortedIndexBuffer[1];
+        sortedidxbufferinfo[1].offset = 0;
+        sortedidxbufferinfo[1].range = sizeof(uint32_t)*ParticleCapacity;
+
+        VkDescriptorBufferInfo pngbrebufferinfo{};
+        pngbrebufferinfo.buffer = ParticleNgbrBuffer;
+        pngbrebufferinfo.offset = 0;
+        pngbrebufferinfo.range = GetParticleNgbrBufferSize();
+
+        VkDescriptorBufferInfo rsbucketbufferinfo{};
+        rsbucketbufferinfo.buffer = RSGlobalBucketBuffer;
+        rsbucketbufferinfo.offset = 0;
+        rsbucketbufferinfo.range = sizeof(uint32_t)*16*(WORK_GROUP_COUNT+1+SCAN_BLOCK_COUNT);
+
+        VkDescriptorBufferInfo cellinfobufferinfo{};
+        cellinfobufferinfo.buffer = CellinfoBuffer;
+        cellinfobufferinfo.offset = 0;
+        cellinfobufferinfo.range = GetCellinfoBufferSize();
+
+        VkDescriptorBufferInfo localprefixbufferinfo{};
+        localprefixbufferinfo.buffer = LocalPrefixBuffer;
+        localprefixbufferinfo.offset = 0;
+        localprefixbufferinfo.range = sizeof(uint32_t)*ParticleCapacity;
+
+        VkDescriptorBufferInfo sortkeybufferinfo[2]{};
+        sortkeybufferinfo[0].buffer = SortKeyBuffer[0];
+        sortkeybufferinfo[0].offset = 0;
+        sortkeybufferinfo[0].range = sizeof(uint32_t)*ParticleCapacity;
+        sortkeybufferinfo[1].buffer = SortKeyBuffer[1];
+        sortkeybufferinfo[1].offset = 0;
+        sortkeybufferinfo[1].range = sizeof(uint32_t)*ParticleCapacity;
+
+        VkDescriptorBufferInfo onesweepbufferinfo{};
+        onesweepbufferinfo.buffer = RSOnesweepBuffer;
+        onesweepbufferinfo.offset = 0;
+        onesweepbufferinfo.range = VK_WHOLE_SIZE;
+
+        VkDescriptorBufferInfo reorderbufferinfo{};
+        reorderbufferinfo.buffer = ReorderBuffer;
+        reorderbufferinfo.offset = 0;
+        reorderbufferinfo.range = GetParticleBufferSize();
+
+        VkDescriptorBufferInfo ngbroffsetbufferinfo{};
+        ngbroffsetbufferinfo.buffer = NgbrOffsetBuffer;
+        ngbroffsetbufferinfo.offset = 0;
+        ngbroffsetbufferinfo.range = sizeof(uint32_t)*(ParticleCapacity+WORK_GROUP_COUNT+SCAN_BLOCK_COUNT);
+
+        VkDescriptorBufferInfo ngbrinfobufferinfo{};
+        ngbrinfobufferinfo.buffer = NgbrInfoBuffer;
+        ngbrinfobufferinfo.offset = 0;
+        ngbrinfobufferinfo.range = sizeof(uint32_t);
+
+        VkDescriptorBufferInfo domainbufferinfo{};
+        domainbufferinfo.buffer = DomainBuffer;
+        domainbufferinfo.offset = 0;
+        domainbufferinfo.range = sizeof(FluidDomainObject)*domainobjs.size();
+
+        VkDescriptorBufferInfo countbufferinfo{};
+        countbufferinfo.buffer = ParticleCountBuffer;
+        countbufferinfo.offset = 0;
+        countbufferinfo.range = sizeof(ParticleCountObject);
+
+        VkDescriptorBufferInfo emitterbufferinfo{};
+        emitterbufferinfo.buffer = EmitterBuffer;
+        emitterbufferinfo.offset = 0;
+        emitterbufferinfo.range = sizeof(ParticleEmitterObject)*std::max<size_t>(emitterobjs.size(),1);
+
+        VkDescriptorBufferInfo sinkbufferinfo{};
+        sinkbufferinfo.buffer = SinkBuffer;
+        sinkbufferinfo.offset = 0;
+        sinkbufferinfo.range = sizeof(ParticleSinkObject)*std::max<size_t>(sinkobjs.size(),1);
+
+        VkDescriptorBufferInfo skinreferencebufferinfo{};
+        skinreferencebufferinfo.buffer = SkinReferenceBuffer;
+        skinreferencebufferinfo.offset = 0;
+        skinreferencebufferinfo.range = VK_WHOLE_SIZE;
+
+        std::array<VkWriteDescriptorSet,19> writes{};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[0].dstArrayElement = 0;
+        writes[0].dstBinding = 0;
+        writes[0].pBufferInfo = &nsbufferinfo;
+
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[1].dstArrayElement = 0;
+        writes[1].dstBinding = 1;
+
+        writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[2].descriptorCount = 1;
+        writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[2].dstArrayElement = 0;
+        writes[2].dstBinding = 2;
+
+        writes[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[3].descriptorCount = 1;
+        writes[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[3].dstArrayElement = 0;
+        writes[3].dstBinding = 3;
+        
+        writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[4].descriptorCount = 1;
+        writes[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[4].dstArrayElement = 0;
+        writes[4].dstBinding = 4;
+        writes[4].pBufferInfo = &pngbrebufferinfo;
+
+        writes[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[5].descriptorCount = 1;
+        writes[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[5].dstArrayElement = 0;
+        writes[5].dstBinding = 5;
+        writes[5].pBufferInfo = &rsbucketbufferinfo;
+
+        writes[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[6].descriptorCount = 1;
+        writes[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[6].dstArrayElement = 0;
+        writes[6].dstBinding = 6;
+        writes[6].pBufferInfo = &cellinfobufferinfo;
+
+        writes[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[7].descriptorCount = 1;
+        writes[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[7].dstArrayElement = 0;
+        writes[7].dstBinding = 7;
+        writes[7].pBufferInfo = &localprefixbufferinfo;
+
+        writes[8].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[8].descriptorCount = 1;
+        writes[8].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[8].dstArrayElement = 0;
+        writes[8].dstBinding = 8;
+
+        writes[9].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[9].descriptorCount = 1;
+        writes[9].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[9].dstArrayElement = 0;
+        writes[9].dstBinding = 9;
+
+        writes[10].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[10].descriptorCount = 1;
+        writes[10].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[10].dstArrayElement = 0;
+        writes[10].dstBinding = 10;
+        writes[10].pBufferInfo = &onesweepbufferinfo;
+
+        writes[11].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[11].descriptorCount = 1;
+        writes[11].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[11].dstArrayElement = 0;
+        writes[11].dstBinding = 11;
+        writes[11].pBufferInfo = &reorderbufferinfo;
+
+        writes[12].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[12].descriptorCount = 1;
+        writes[12].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[12].dstArrayElement = 0;
+        writes[12].dstBinding = 12;
+        writes[12].pBufferInfo = &ngbroffsetbufferinfo;
+
+        writes[13].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[13].descriptorCount = 1;
+        writes[13].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[13].dstArrayElement = 0;
+        writes[13].dstBinding = 13;
+        writes[13].pBufferInfo = &ngbrinfobufferinfo;
+
+        writes[14].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[14].descriptorCount = 1;
+        writes[14].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[14].dstArrayElement = 0;
+        writes[14].dstBinding = 14;
+        writes[14].pBufferInfo = &domainbufferinfo;
+
+        writes[15].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[15].descriptorCount = 1;
+        writes[15].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[15].dstArrayElement = 0;
+        writes[15].dstBinding = 15;
+        writes[15].pBufferInfo = &countbufferinfo;
+
+        writes[16].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[16].descriptorCount = 1;
+        writes[16].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[16].dstArrayElement = 0;
+        writes[16].dstBinding = 16;
+        writes[16].pBufferInfo = &emitterbufferinfo;
+
+        writes[17].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[17].descriptorCount = 1;
+        writes[17].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[17].dstArrayElement = 0;
+        writes[17].dstBinding = 17;
+        writes[17].pBufferInfo = &sinkbufferinfo;
+
+        writes[18].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[18].descriptorCount = 1;
+        writes[18].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[18].dstArrayElement = 0;
+        writes[18].dstBinding = 18;
+        writes[18].pBufferInfo = &skinreferencebufferinfo;
+
+        for(uint32_t i=0;i<2;++i){
+            writes[1].pBufferInfo = &sortedidxbufferinfo[i];
+            writes[2].pBufferInfo = &sortedidxbufferinfo[i^1];
+            writes[8].pBufferInfo = &sortkeybufferinfo[i];
+            writes[9].pBufferInfo = &sortkeybufferinfo[i^1];
+            for(uint32_t j=0;j<MAXInFlightRendering;++j){
+                VkDescriptorBufferInfo particlebufferinfo{};
+                particlebufferinfo.buffer = ParticleBuffers[j];
+                particlebufferinfo.offset = 0;
+                particlebufferinfo.range = GetParticleBufferSize();
+                writes[3].pBufferInfo = &particlebufferinfo;
+
+                writes[0].dstSet = NSDescriptorSets[i][j];
+                writes[1].dstSet = NSDescriptorSets[i][j];
+                writes[2].dstSet = NSDescriptorSets[i][j];
+                writes[3].dstSet = NSDescriptorSets[i][j];
+                writes[4].dstSet = NSDescriptorSets[i][j];
+                writes[5].dstSet = NSDescriptorSets[i][j];
+                writes[6].dstSet = NSDescriptorSets[i][j];
+                writes[7].dstSet = NSDescriptorSets[i][j];
+                writes[8].dstSet = NSDescriptorSets[i][j];
+                writes[9].dstSet = NSDescriptorSets[i][j];
+                writes[10].dstSet = NSDescriptorSets[i][j];
+                writes[11].dstSet = NSDescriptorSets[i][j];
+                writes[12].dstSet = NSDescriptorSets[i][j];
+                writes[13].dstSet = NSDescriptorSets[i][j];
+                writes[14].dstSet = NSDescriptorSets[i][j];
+                writes[15].dstSet = NSDescriptorSets[i][j];
+                writes[16].dstSet = NSDescriptorSets[i][j];
+                writes[17].dstSet = NSDescriptorSets[i][j];
+                writes[18].dstSet = NSDescriptorSets[i][j];
+
+                vkUpdateDescriptorSets(LDevice,static_cast<uint32_t>(writes.size()),writes.data(),0,nullptr);
+            }
+        }
+    }
+}
+void FluidSolver::CreateComputePipelineLayout()
+{
+    VkPipelineLayoutCreateInfo nscreateinfo{};
+    nscreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    nscreateinfo.pSetLayouts = &NSDescriptorSetLayout;
+    nscreateinfo.setLayoutCount = 1;
+    if(vkCreatePipelineLayout(LDevice,&nscreateinfo,Allocator,&NSPipelineLayout)!=VK_SUCCESS){
+        throw std::runtime_error("failed to create neighborhood searcher pipeline layout!");
+    }
+    VkPipelineLayoutCreateInfo simulatecreateinfo{};
+    simulatecreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    simulatecreateinfo.pSetLayouts = &SimulateDescriptorSetLayout;
+    simulatecreateinfo.setLayoutCount = 1;
+    if(vkCreatePipelineLayout(LDevice,&simulatecreateinfo,Allocator,&SimulatePipelineLayout)!=VK_SUCCESS){
+        throw std::runtime_error("failed to create simulate pipeline layout!");
+    }
+}
+void FluidSolver::CreateComputePipeline()
+{
+    {
+        //NGBR PIPELINES
+        auto computeshadermodule_calcellhash = MakeShaderModule(GetParticleShaderPath("calcellhash").c_str());
+        auto computeshadermodule_radixsort1 = MakeShaderModule(GetParticleShaderPath("radixsort1").c_str());
+        auto computeshadermodule_radixsort2 = MakeShaderModule(GetParticleShaderPath("radixsort2").c_str());
+        auto computeshadermodule_radixsort3 = MakeShaderModule(GetParticleShaderPath("radixsort3").c_str());
+        auto computeshadermodule_radixsorthistogram = MakeShaderModule(GetParticleShaderPath("radixsort_histogram").c_str());
+        auto computeshadermodule_radixsortonesweep = MakeShaderModule(GetParticleShaderPath("radixsort_onesweep").c_str());
+        auto computeshadermodule_reorder = MakeShaderModule(GetParticleShaderPath("reorder").c_str());
+        auto computeshadermodule_fixcellbuffer = MakeShaderModule(GetParticleShaderPath("fixcellbuffer").c_str());
+        auto computeshadermodule_getngbrs = MakeShaderModule(GetParticleShaderPath("getngbrs").c_str());
+        auto computeshadermodule_ngbrcount = MakeShaderModule(GetParticleShaderPath("ngbrcount").c_str());
+        auto computeshadermodule_ngbrscan = MakeShaderModule(GetParticleShaderPath("ngbrscan").c_str());
+        auto computeshadermodule_ngbrfill = MakeShaderModule(GetParticleShaderPath("ngbrfill").c_str());
+        auto computeshadermodule_radixsortblockscan = MakeShaderModule(GetParticleShaderPath("radixsort_blockscan").c_str());
+        auto computeshadermodule_ngbrblockscan = MakeShaderModule(GetParticleShaderPath("ngbrblockscan").c_str());
+        auto computeshadermodule_particlesink = MakeShaderModule(GetParticleShaderPath("particlesink").c_str());
+        auto computeshadermodule_particlesinkscan = MakeShaderModule(GetParticleShaderPath("particlesinkscan").c_str());
+        auto computeshadermodule_particlecompact = MakeShaderModule(GetParticleShaderPath("particlecompact").c_str());
+        auto computeshadermodule_particlecopy = MakeShaderModule(GetParticleShaderPath("particlecopy").c_str());
+        auto computeshadermodule_particleemit = MakeShaderModule(GetParticleShaderPath("particleemit").c_str());
+        auto computeshadermodule_particlecount = MakeShaderModule(GetParticleShaderPath("particlecount").c_str());
+        auto computeshadermodule_cellclear = MakeShaderModule(GetParticleShaderPath("cellclear").c_str());
+        auto computeshadermodule_ngbrdisplacement = MakeShaderModule(GetParticleShaderPath("ngbrdisplacement").c_str());
+        auto computeshadermodule_ngbrschedule = MakeShaderModule(GetParticleShaderPath("ngbrschedule").c_str());
+        auto computeshadermodule_cellcount = MakeShaderModule(GetParticleShaderPath("cellcount").c_str());
+        auto computeshadermodule_cellscan = MakeShaderModule(GetParticleShaderPath("cellscan").c_str());
+        auto computeshadermodule_cellscatter = MakeShaderModule(GetParticleShaderPath("cellscatter").c_str());
+
+        std::vector<VkShaderModule> shadermodules = {computeshadermodule_calcellhash,computeshadermodule_radixsort1,computeshadermodule_radixsort2,
+        computeshadermodule_radixsort3,computeshadermodule_fixcellbuffer,computeshadermodule_getngbrs,
+        computeshadermodule_radixsorthistogram,computeshadermodule_radixsortonesweep,computeshadermodule_reorder,
+        computeshadermodule_ngbrcount,computeshadermodule_ngbrscan,computeshadermodule_ngbrfill,
+        computeshadermodule_particlesink,computeshadermodule_particleemit,computeshadermodule_particlecount,
+        computeshadermodule_particlesinkscan,computeshadermodule_particlecompact,computeshadermodule_particlecopy,
+        computeshadermodule_radixsortblockscan,computeshadermodule_ngbrblockscan,
+        computeshadermodule_cellcount,computeshadermodule_cellscan,computeshadermodule_cellscatter,
+        computeshadermodule_ngbrdisplacement,computeshadermodule_ngbrschedule,computeshadermodule_cellclear};
+        std::vector<VkPipeline*> pcomputepipelines = {&NSPipeline_CalcellHash,&NSPipeline_Radixsort1,&NSPipeline_Radixsort2,
+        &NSPipeline_Radixsort3,&NSPipeline_FixcellBuffer,&NSPipeline_GetNgbrs,
+        &NSPipeline_RadixsortHistogram,&NSPipeline_RadixsortOnesweep,&NSPipeline_Reorder,
+        &NSPipeline_NgbrCount,&NSPipeline_NgbrScan,&NSPipeline_NgbrFill,
+        &NSPipeline_ParticleSink,&NSPipeline_ParticleEmit,&NSPipeline_ParticleCount,
+        &NSPipeline_ParticleSinkScan,&NSPipeline_ParticleCompact,&NSPipeline_ParticleCopy,
+        &NSPipeline_RadixsortBlockScan,&NSPipeline_NgbrBlockScan,
+        &NSPipeline_CellCount,&NSPipeline_CellScan,&NSPipeline_CellScatter,
+        &NSPipeline_NgbrDisplacement,&NSPipeline_NgbrSchedule,&NSPipeline_CellClear}; 
+        
+        for(uint32_t i=0;i<shadermodules.size();++i){
+            VkPipelineShaderStageCreateInfo stageinfo{};
+            stageinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stageinfo.pName = "main";
+            stageinfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            stageinfo.module = shadermodules[i];
+            stageinfo.pSpecializationInfo = GetParticleSpecialization();
+            VkComputePipelineCreateInfo createinfo{};
+            createinfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            createinfo.layout = NSPipelineLayout;
+            createinfo.stage = stageinfo;
+            if(vkCreateComputePipelines(LDevice,VK_NULL_HANDLE,1,&createinfo,Allocator,pcomputepipelines[i])!=VK_SUCCESS){
+                throw std::runtime_error("failed to create ns compute pipeline!");
+            }
+        }
+
+        for(auto& computershadermodule:shadermodules){
+            vkDestroyShaderModule(LDevice,computershadermodule,Allocator);
+        }
+    }
+
+    {
+        //SIMULATING PIPELINES
+        auto computershadermodule_euler = MakeShaderModule(GetParticleShaderPath("euler").c_str());
+        auto computershadermodule_lambda = MakeShaderModule(GetParticleShaderPath("lambda").c_str());
+        auto computershadermodule_deltaposition = MakeShaderModule(GetParticleShaderPath("deltaposition").c_str());
+        auto computershadermodule_positionupd = MakeShaderModule(GetParticleShaderPath("positionupd").c_str());
+        auto computershadermodule_velocityupd = MakeShaderModule(GetParticleShaderPath("velocityupd").c_str());
+        auto computershadermodule_velocitycache = MakeShaderModule(GetParticleShaderPath("velocitycache").c_str());
+        auto computershadermodule_viscositycorr = MakeShaderModule(GetParticleShaderPath("viscositycorr").c_str());
+        auto computershadermodule_vorticitycorr = MakeShaderModule(GetParticleShaderPath("vorticitycorr").c_str());
+        auto computershadermodule_solve = MakeShaderModule(GetParticleShaderPath("solve").c_str());
+        auto computershadermodule_ngbrtotal = MakeShaderModule(GetParticleShaderPath("ngbrtotal").c_str());
+
+        std::vector<VkShaderModule> shadermodules = {computershadermodule_euler,computershadermodule_lambda,computershadermodule_deltaposition,
+        computershadermodule_positionupd,computershadermodule_velocityupd,computershadermodule_velocitycache,
+        computershadermodule_viscositycorr,computershadermodule_vorticitycorr,computershadermodule_solve,computershadermodule_ngbrtotal};
+        std::vector<VkPipeline*> pcomputepipelines = {&SimulatePipeline_Euler,&SimulatePipeline_Lambda,&SimulatePipeline_DeltaPosition,
+        &SimulatePipeline_PositionUpd,&SimulatePipeline_VelocityUpd, 
+        &SimulatePipeline_VelocityCache,&SimulatePipeline_ViscosityCorr, &SimulatePipeline_VorticityCorr,&SimulatePipeline_Solve,
+        &SimulatePipeline_NgbrTotal};
+
+        for(uint32_t i=0;i<shadermodules.size();++i){
+            VkPipelineShaderStageCreateInfo stageinfo{};
+            stageinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stageinfo.pName = "main";
+            stageinfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            stageinfo.module = shadermodules[i];
+            stageinfo.pSpecializationInfo = GetParticleSpecialization();
+            VkComputePipelineCreateInfo createinfo{};
+            createinfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            createinfo.layout = SimulatePipelineLayout;
+            createinfo.stage = stageinfo;
+            if(vkCreateComputePipelines(LDevice,VK_NULL_HANDLE,1,&createinfo,Allocator,pcomputepipelines[i])!=VK_SUCCESS){
+                throw std::runtime_error("failed to create simulating compute pipeline!");
+            }
+        }
+
+        for(auto& computershadermodule:shadermodules){
+            vkDestroyShaderModule(LDevice,computershadermodule,Allocator);
+        }
+    }
+}
+void FluidSolver::CleanupComputePipeline()
+{
+    vkDestroyPipeline(LDevice,NSPipeline_CalcellHash,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_Radixsort1,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_Radixsort2,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_RadixsortBlockScan,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_Radixsort3,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_RadixsortHistogram,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_RadixsortOnesweep,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_CellClear,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_NgbrDisplacement,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_NgbrSchedule,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_CellCount,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_CellScan,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_CellScatter,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_Reorder,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_FixcellBuffer,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_GetNgbrs,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_NgbrCount,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_NgbrScan,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_NgbrBlockScan,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_NgbrFill,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_ParticleSink,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_ParticleSinkScan,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_ParticleCompact,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_ParticleCopy,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_ParticleEmit,Allocator);
+    vkDestroyPipeline(LDevice,NSPipeline_ParticleCount,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_Euler,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_Lambda,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_DeltaPosition,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_PositionUpd,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_Solve,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_VelocityUpd,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_VelocityCache,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_ViscosityCorr,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_VorticityCorr,Allocator);
+    vkDestroyPipeline(LDevice,SimulatePipeline_NgbrTotal,Allocator);
+}
+void FluidSolver::RecordSimulatingCommandBuffers()
+{
+    SimulatingCommandBuffers.resize(MAXInFlightRendering);
+    for(uint32_t i=0;i<MAXInFlightRendering;++i){
+        VkCommandBufferAllocateInfo allocateinfo{};
+        allocateinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateinfo.commandPool = CommandPool;
+        allocateinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateinfo.commandBufferCount = 1;
+        if(vkAllocateCommandBuffers(LDevice,&allocateinfo,&SimulatingCommandBuffers[i])!=VK_SUCCESS){
+            throw std::runtime_error("failed to allocate simulating command buffer!");
+        }
+        VkCommandBufferBeginInfo begininfo{};
+        begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begininfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+        if(vkBeginCommandBuffer(SimulatingCommandBuffers[i],&begininfo)!=VK_SUCCESS){
+            throw std::runtime_error("failed to begin simulating command buffer!");
+        }
+        Profiler.BeginSlot(SimulatingCommandBuffers[i],i);
+        //the draw reads the particles and the live count the emit/sink pass is about to rewrite
+        VkMemoryBarrier memorybarrier{};
+        memorybarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memorybarrier.srcAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT|VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        memorybarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_VERTEX_INPUT_BIT|VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+        memorybarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        memorybarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        //                  EMITTERS AND SINKS
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        //a stable compaction of the input of this step:flags scanned like the packed neighbor list,
+        //the survivors only move through the reorder buffer on steps something was sunk,then the due emitter layers go behind them
+        if(!emitterobjs.empty() || !sinkobjs.empty()){
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"emit and sink");
+            uint32_t lastflight = (i+MAXInFlightRendering-1)%MAXInFlightRendering;
+            VkMemoryBarrier indirectbarrier{};
+            indirectbarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            indirectbarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            indirectbarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT|VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+            vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipelineLayout,0,1,&NSDescriptorSets[0][lastflight],0,nullptr);
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_ParticleSink);
+            vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);
+
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_NgbrScan);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            vkCmdDispatch(SimulatingCommandBuffers[i],SCAN_BLOCK_COUNT,1,1);
+
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_ParticleSinkScan);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            vkCmdDispatch(SimulatingCommandBuffers[i],1,1,1);
+
+            //zero groups when nothing was sunk
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_ParticleCompact);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT|VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,0,1,&indirectbarrier,0,nullptr,0,nullptr);
+            vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,offsetof(ParticleCountObject,compactGroups));
+
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_ParticleCopy);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,offsetof(ParticleCountObject,compactGroups));
+
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_ParticleEmit);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            if(GetEmitGroupCount() != 0){
+                vkCmdDispatch(SimulatingCommandBuffers[i],GetEmitGroupCount(),1,1);
+            }
+
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_ParticleCount);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            vkCmdDispatch(SimulatingCommandBuffers[i],1,1,1);
+
+            //every dispatch from here on is sized from the new count
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT|VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,0,1,&indirectbarrier,0,nullptr,0,nullptr);
+        }
+
+        
+        Profiler.MarkStage(SimulatingCommandBuffers[i],i,"euler");
+        vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipelineLayout,0,1,&SimulateDescriptorSet[i],0,nullptr);
+        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_Euler);
+        vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);
+        
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        //                  SEARCHING NEIGHBORS
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipelineLayout,0,1,&NSDescriptorSets[0][i],0,nullptr);
+        //with a skin every dispatch of the search takes its groups from ngbrschedule.comp,which zeroes them while the last lists hold
+        auto dispatchsearch = [&](){
+            vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,NeighborSkin>0?offsetof(ParticleCountObject,rebuildParticleGroups):0);
+        };
+        auto dispatchsearchgroups = [&](uint32_t groups,VkDeviceSize offset){
+            if(NeighborSkin>0){
+                vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,offset);
+            }
+            else{
+                vkCmdDispatch(SimulatingCommandBuffers[i],groups,1,1);
+            }
+        };
+        if(NeighborSkin>0){
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"skin check");
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_NgbrDisplacement);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);
+
+            //the last step's search may still be reading the group counts about to be rewritten
+            VkMemoryBarrier schedulebarrier{};
+            schedulebarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            schedulebarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            schedulebarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT|VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&schedulebarrier,0,nullptr,0,nullptr);
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_NgbrSchedule);
+            vkCmdDispatch(SimulatingCommandBuffers[i],1,1,1);
+            schedulebarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT|VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT|VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,0,1,&schedulebarrier,0,nullptr,0,nullptr);
+        }
+
+        //empty the cell table,cells a drained particle left behind included
+        //a fill can not be skipped from the gpu,so with a skin a kernel clears it only when the search runs
+        Profiler.MarkStage(SimulatingCommandBuffers[i],i,"cell clear");
+        if(NeighborSkin>0){
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_CellClear);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,offsetof(ParticleCountObject,rebuildCellGroups));
+        }
+        else{
+            VkMemoryBarrier clearbarrier{};
+            clearbarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            clearbarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT;
+            clearbarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,0,1,&clearbarrier,0,nullptr,0,nullptr);
+            vkCmdFillBuffer(SimulatingCommandBuffers[i],CellinfoBuffer,0,VK_WHOLE_SIZE,0);
+            clearbarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            clearbarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&clearbarrier,0,nullptr,0,nullptr);
+        }
+
+        Profiler.MarkStage(SimulatingCommandBuffers[i],i,"calcellhash");
+        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_CalcellHash);
+        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+        dispatchsearch();
+        
+        if(radixsortmode == RadixsortMode::ONESWEEP || radixsortmode == RadixsortMode::COUNTING){
+            //histograms,partition ticket and look-back status all start from zero every step
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"sort clear");
+            VkMemoryBarrier fillbarrier{};
+            fillbarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            fillbarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT;
+            fillbarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,0,1,&fillbarrier,0,nullptr,0,nullptr);
+            vkCmdFillBuffer(SimulatingCommandBuffers[i],RSOnesweepBuffer,0,VK_WHOLE_SIZE,0);
+            fillbarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            fillbarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&fillbarrier,0,nullptr,0,nullptr);
+        }
+        if(radixsortmode == RadixsortMode::COUNTING){
+            //the table starts out cleared,count every cell,scan the counts into ranges,then scatter by rank
+            //the single pass writes binding 2 of set 0 like a one pass radixsort would
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"cellcount");
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_CellCount);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearch();
+
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"cellscan");
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_CellScan);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearchgroups(GetCellScanBlockCount(),offsetof(ParticleCountObject,rebuildCellScanGroups));
+
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"cellscatter");
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_CellScatter);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearch();
+        }
+        else if(radixsortmode == RadixsortMode::ONESWEEP){
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"radixsort histogram");
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_RadixsortHistogram);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearch();
+
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_RadixsortOnesweep);
+            for(uint32_t iter=0;iter<RADIX_SORT_PASSES;++iter){
+                Profiler.MarkStage(SimulatingCommandBuffers[i],i,"radixsort pass "+std::to_string(iter));
+                vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipelineLayout,0,1,&NSDescriptorSets[iter%2][i],0,nullptr);
+                vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+                dispatchsearch();
+            }
+        }
+        else{
+            for(uint32_t iter=0;iter<RADIX_SORT_PASSES;++iter){
+                Profiler.MarkStage(SimulatingCommandBuffers[i],i,"radixsort pass "+std::to_string(iter));
+                vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipelineLayout,0,1,&NSDescriptorSets[iter%2][i],0,nullptr);
+
+                vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_Radixsort1);
+                vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+                dispatchsearch();
+
+                //two level scan of the workgroup buckets,sized for the capacity
+                vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_Radixsort2);
+                vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+                dispatchsearchgroups(SCAN_BLOCK_COUNT,offsetof(ParticleCountObject,rebuildScanGroups));
+
+                vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_RadixsortBlockScan);
+                vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+                dispatchsearchgroups(1,offsetof(ParticleCountObject,rebuildSingleGroup));
+
+                vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_Radixsort3);
+                vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+                dispatchsearch();
+
+            }
+        }
+        
+        //the cell scan already wrote every range
+        if(radixsortmode != RadixsortMode::COUNTING){
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"fixcellbuffer");
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_FixcellBuffer);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearch();
+        }
+
+        //the cell walk reads cellinfo straight from the constraint kernels
+        if(neighbormode == NeighborMode::LIST){
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"getngbrs");
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_GetNgbrs);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearch();
+        }
+        else if(neighbormode == NeighborMode::COMPACTLIST){
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"getngbrs");
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_NgbrCount);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearch();
+
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_NgbrScan);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearchgroups(SCAN_BLOCK_COUNT,offsetof(ParticleCountObject,rebuildScanGroups));
+
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_NgbrBlockScan);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearchgroups(1,offsetof(ParticleCountObject,rebuildSingleGroup));
+
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_NgbrFill);
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+            dispatchsearch();
+
+            //make the total visible to the host check in Simulate
+            VkMemoryBarrier hostbarrier{};
+            hostbarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            hostbarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            hostbarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_HOST_BIT,0,1,&hostbarrier,0,nullptr,0,nullptr);
+        }
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+
+        vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipelineLayout,0,1,&SimulateDescriptorSet[i],0,nullptr);
+
+        for(uint32_t iter=0;iter<SolverIterations;++iter){
+            Profiler.MarkStage(SimulatingCommandBuffers[i],i,"solver iteration "+std::to_string(iter));
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+            ,0,nullptr,0,nullptr);
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_Lambda);
+            vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);
+
+            //delta position and position update in one jacobi dispatch,velocityupd commits the last iteration
+            if(bFusedSolver){
+                vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+                ,0,nullptr,0,nullptr);
+                vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_Solve);
+                vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);
+                continue;
+            }
+
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+            ,0,nullptr,0,nullptr);
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_DeltaPosition);
+            vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);    
+
+            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+            ,0,nullptr,0,nullptr);
+            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_PositionUpd);
+            vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0); 
+        }
+        Profiler.MarkStage(SimulatingCommandBuffers[i],i,"velocityupd");
+        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+        ,0,nullptr,0,nullptr);
+        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_VelocityUpd);
+        vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);   
+
+        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+        ,0,nullptr,0,nullptr);
+        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_VelocityCache);
+        vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);  
+
+        Profiler.MarkStage(SimulatingCommandBuffers[i],i,"viscosity");
+        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+        ,0,nullptr,0,nullptr);
+        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_ViscosityCorr);
+        vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);  
+
+        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+        ,0,nullptr,0,nullptr);
+        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_VelocityCache);
+        vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0);  
+
+        Profiler.MarkStage(SimulatingCommandBuffers[i],i,"vorticity");
+        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+        ,0,nullptr,0,nullptr);
+        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_VorticityCorr);
+        vkCmdDispatchIndirect(SimulatingCommandBuffers[i],ParticleCountBuffer,0); 
+        Profiler.EndSlot(SimulatingCommandBuffers[i],i);
+
+        auto result = vkEndCommandBuffer(SimulatingCommandBuffers[i]);
+        if(result != VK_SUCCESS){
+            throw std::runtime_error("failed to end simulating command buffer!");
+        }
+    }
+}
+void FluidSolver::RecordReorderCommandBuffers()
+{
+    ReorderCommandBuffers.resize(MAXInFlightRendering);
+    for(uint32_t i=0;i<MAXInFlightRendering;++i){
+        VkCommandBufferAllocateInfo allocateinfo{};
+        allocateinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateinfo.commandPool = CommandPool;
+        allocateinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateinfo.commandBufferCount = 1;
+        if(vkAllocateCommandBuffers(LDevice,&allocateinfo,&ReorderCommandBuffers[i])!=VK_SUCCESS){
+            throw std::runtime_error("failed to allocate reorder command buffer!");
+        }
+        VkCommandBufferBeginInfo begininfo{};
+        begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begininfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+        if(vkBeginCommandBuffer(ReorderCommandBuffers[i],&begininfo)!=VK_SUCCESS){
+            throw std::runtime_error("failed to begin reorder command buffer!");
+        }
+        Profiler.BeginSlot(ReorderCommandBuffers[i],MAXInFlightRendering+i);
+        Profiler.MarkStage(ReorderCommandBuffers[i],MAXInFlightRendering+i,"reorder");
+        //ParticleBuffers[i] was written by the last step of flight i and may still be drawn
+        VkMemoryBarrier memorybarrier{};
+        memorybarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memorybarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        memorybarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT|VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        vkCmdPipelineBarrier(ReorderCommandBuffers[i],VK_PIPELINE_STAGE_VERTEX_INPUT_BIT|VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT|VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+
+        //the last sorting pass wrote the cell ordered indices to binding 2 of set (RADIX_SORT_PASSES-1)%2
+        vkCmdBindDescriptorSets(ReorderCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipelineLayout,0,1,&NSDescriptorSets[(RADIX_SORT_PASSES-1)%2][i],0,nullptr);
+        vkCmdBindPipeline(ReorderCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_Reorder);
+        vkCmdDispatchIndirect(ReorderCommandBuffers[i],ParticleCountBuffer,0);
+
+        memorybarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT;
+        memorybarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT|VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(ReorderCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+
+        VkBufferCopy region{};
+        region.size = GetParticleBufferSize();
+        region.dstOffset = region.srcOffset = 0;
+        vkCmdCopyBuffer(ReorderCommandBuffers[i],ReorderBuffer,ParticleBuffers[i],1,&region);
+        //the kept neighbor lists index the old order
+        if(NeighborSkin>0){
+            vkCmdFillBuffer(ReorderCommandBuffers[i],ParticleCountBuffer,offsetof(ParticleCountObject,forceRebuild),sizeof(uint32_t),1);
+        }
+
+        memorybarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT|VK_ACCESS_TRANSFER_WRITE_BIT;
+        memorybarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT|VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        vkCmdPipelineBarrier(ReorderCommandBuffers[i],VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT|VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
+        Profiler.EndSlot(ReorderCommandBuffers[i],MAXInFlightRendering+i);
+
+        if(vkEndCommandBuffer(ReorderCommandBuffers[i])!=VK_SUCCESS){
+            throw std::runtime_error("failed to end reorder command buffer!");
+        }
+    }
+}
+uint32_t FluidSolver::GetRadixsortPasses(uint32_t hashsize)
+{
+    //the counting sort places every particle in one pass,whatever the key width
+    if(radixsortmode == RadixsortMode::COUNTING){
+        return 1;
+    }
+    //keys are reduced modulo hashsize,so only the low bits of hashsize-1 can be set
+    uint32_t keybits = hashsize>1?std::bit_width(hashsize-1):1;
+    return (keybits+RADIX_SORT_BITS-1)/RADIX_SORT_BITS;
+}
+uint32_t FluidSolver::GetCellScanBlockCount()
+{
+    return (nsobject.hashsize+CELL_SCAN_CELLS_PER_BLOCK-1)/CELL_SCAN_CELLS_PER_BLOCK;
+}
+bool FluidSolver::IsOnesweepSupported(VkPhysicalDevice pdevice)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(pdevice,&properties);
+    if(properties.apiVersion < VK_API_VERSION_1_1) return false;
+
+    VkPhysicalDeviceSubgroupProperties subgroupproperties{};
+    subgroupproperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &subgroupproperties;
+    vkGetPhysicalDeviceProperties2(pdevice,&properties2);
+
+    VkSubgroupFeatureFlags needed = VK_SUBGROUP_FEATURE_BASIC_BIT|VK_SUBGROUP_FEATURE_BALLOT_BIT|VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    if((subgroupproperties.supportedStages&VK_SHADER_STAGE_COMPUTE_BIT) == 0) return false;
+    if((subgroupproperties.supportedOperations&needed) != needed) return false;
+    //the digit scan keeps one partial sum per subgroup in 64 shared slots
+    if(subgroupproperties.subgroupSize < 4) return false;
+    return true;
+}
+void FluidSolver::Simulate()
+{
+    SimulateSteps(1);
+}
+void FluidSolver::SimulateSteps(uint32_t steps)
+{
+    if(steps == 0){
+        return;
+    }
+    //a packed neighbor list that overflowed in an earlier step is regrown before it is used again
+    if(neighbormode == NeighborMode::COMPACTLIST && *reinterpret_cast<uint32_t*>(MappedNgbrInfoBuffer) > NgbrCapacity){
+        RegrowParticleNgbrBuffer();
+    }
+    //timings of whatever earlier submissions finished by now
+    Profiler.Collect();
+    //every substep advances the flight,the rendered buffer is the one the last substep wrote
+    //all steps go into one submission replaying the prerecorded command buffers
+    std::vector<VkCommandBuffer> cbs;
+    for(uint32_t substep=0;substep<steps*Substeps;++substep){
+        uint32_t lastflight = CurrentFlight;
+        CurrentFlight = (CurrentFlight + 1)%MAXInFlightRendering;
+
+        //reorder the input of this step by the cell order the last step sorted
+        bool reorder = ReorderInterval != 0 && SimulatedSteps != 0 && SimulatedSteps%ReorderInterval == 0;
+        ++SimulatedSteps;
+        if(reorder){
+            cbs.push_back(ReorderCommandBuffers[lastflight]);
+            Profiler.MarkSubmitted(MAXInFlightRendering+lastflight);
+        }
+        cbs.push_back(SimulatingCommandBuffers[CurrentFlight]);
+        Profiler.MarkSubmitted(CurrentFlight);
+    }
+    
+    VkSubmitInfo submitinfo{};
+    submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitinfo.commandBufferCount = static_cast<uint32_t>(cbs.size());
+    submitinfo.pCommandBuffers = cbs.data();
+    submitinfo.signalSemaphoreCount = 1;
+    submitinfo.pSignalSemaphores = &SimulatingFinish;
+    //several submissions between two draws chain through the semaphore,so the draw waits for the latest
+    VkPipelineStageFlags waitstage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    if(bSimulatingSignaled){
+        submitinfo.waitSemaphoreCount = 1;
+        submitinfo.pWaitSemaphores = &SimulatingFinish;
+        submitinfo.pWaitDstStageMask = &waitstage;
+    }
+
+    if(vkQueueSubmit(ComputeQueue,1,&submitinfo,VK_NULL_HANDLE)!=VK_SUCCESS){
+        throw std::runtime_error("failed to submit simulating command buffer!");
+    }
+    bSimulatingSignaled = true;
+}
+VkSemaphore FluidSolver::TakeSimulatingSemaphore()
+{
+    //whoever consumes the particle buffers waits on the latest step once,later submissions chain again
+    if(!bSimulatingSignaled){
+        return VK_NULL_HANDLE;
+    }
+    bSimulatingSignaled = false;
+    return SimulatingFinish;
+}
+void FluidSolver::WaitIdle()
+{
+    vkQueueWaitIdle(ComputeQueue);
+    //the steps submitted last are done too
+    Profiler.Collect();
+}
+float FluidSolver::GetMeanNeighborCount()
+{
+    vkQueueWaitIdle(ComputeQueue);
+    //the lists or the sorted cells of the last step are still bound to the flight that produced it
+    auto cb = CreateCommandBuffer();
+    vkCmdFillBuffer(cb,ParticleCountBuffer,offsetof(ParticleCountObject,ngbrTotal),sizeof(uint32_t),0);
+    VkMemoryBarrier memorybarrier{};
+    memorybarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memorybarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memorybarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT|VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(cb,VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT|VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
+    ,0,nullptr,0,nullptr);
+    vkCmdBindDescriptorSets(cb,VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipelineLayout,0,1,&SimulateDescriptorSet[CurrentFlight],0,nullptr);
+    vkCmdBindPipeline(cb,VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_NgbrTotal);
+    vkCmdDispatchIndirect(cb,ParticleCountBuffer,0);
+    VkSubmitInfo submitinfo{};
+    SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,ComputeQueue);
+
+    auto count = ReadParticleCountObject();
+    if(count.liveParticles == 0){
+        return 0.0f;
+    }
+    return static_cast<float>(count.ngbrTotal)/count.liveParticles;
+}
+void FluidSolver::GetStageTraffic(uint32_t particles,float neighbors,std::vector<GpuStageTraffic>& traffic)
+{
+    traffic.clear();
+    auto add = [&](const std::string& name,double bytesread,double byteswritten){
+        GpuStageTraffic stage;
+        stage.name = name;
+        stage.bytesread = bytesread;
+        stage.byteswritten = byteswritten;
+        traffic.push_back(stage);
+    };
+    double n = particles;
+    double k = neighbors;
+    //bytes of a whole particle,of a vector field and of a scalar field
+    double record = static_cast<double>(GetParticleBufferSize())/std::max(ParticleCapacity,1u);
+    double vec = particlelayout == ParticleLayout::COMPACT ? 8 : 16;
+    double scalar = particlelayout == ParticleLayout::COMPACT ? 2 : 4;
+    double index = sizeof(uint32_t);
+    double keyvalue = 2*sizeof(uint32_t);
+    double cells = nsobject.hashsize;
+    //the 27 cells hold about 27/(4pi/3) times the neighbors inside the sphere
+    double candidates = k*27.0/(4.0*std::numbers::pi/3.0);
+    //per particle bytes of walking the neighbors and reading fields bytes of each
+    auto ngbrwalk = [&](double fields){
+        if(neighbormode == NeighborMode::CELLWALK){
+            return n*(27*keyvalue+candidates*(index+vec)+k*(fields-vec));
+        }
+        return n*k*(index+fields);
+    };
+
+    if(!emitterobjs.empty() || !sinkobjs.empty()){
+        //a step that sinks nothing only flags and scans,the records move twice on the steps that do
+        add("emit and sink",n*vec,n*index);
+    }
+    add("euler",n*record,n*record);
+    if(NeighborSkin>0){
+        add("skin check",2*n*vec,0);
+    }
+    add("cell clear",0,cells*keyvalue);
+    add("calcellhash",n*(vec+index),n*keyvalue);
+    if(radixsortmode == RadixsortMode::COUNTING){
+        add("cellcount",n*index,2*n*index);
+        add("cellscan",cells*index,cells*keyvalue);
+        add("cellscatter",n*(keyvalue+index),n*index);
+    }
+    else if(radixsortmode == RadixsortMode::ONESWEEP){
+        add("radixsort histogram",n*index,0);
+        for(uint32_t iter=0;iter<RADIX_SORT_PASSES;++iter){
+            add("radixsort pass "+std::to_string(iter),n*keyvalue,n*keyvalue);
+        }
+    }
+    else{
+        //the count and the scatter both read the keys
+        for(uint32_t iter=0;iter<RADIX_SORT_PASSES;++iter){
+            add("radixsort pass "+std::to_string(iter),2*n*keyvalue,n*keyvalue);
+        }
+    }
+    if(radixsortmode != RadixsortMode::COUNTING){
+        add("fixcellbuffer",n*keyvalue,n*index);
+    }
+    double search = n*(vec+index+27*keyvalue)+n*candidates*(index+vec);
+    if(neighbormode == NeighborMode::LIST){
+        add("getngbrs",search,n*k*index+n*index);
+    }
+    else if(neighbormode == NeighborMode::COMPACTLIST){
+        //count and fill walk the cells twice,the scans read and write the counts
+        add("getngbrs",2*search+2*n*index,n*k*index+3*n*index);
+    }
+
+    for(uint32_t iter=0;iter<SolverIterations;++iter){
+        double lambdaread = n*(vec+index)+ngbrwalk(vec);
+        double lambdawritten = 2*n*scalar;
+        if(bFusedSolver){
+            add("solver iteration "+std::to_string(iter),lambdaread+n*(vec+scalar)+ngbrwalk(vec+scalar),lambdawritten+2*n*vec);
+        }
+        else{
+            add("solver iteration "+std::to_string(iter),lambdaread+n*(vec+scalar)+ngbrwalk(vec+scalar)+2*n*vec,lambdawritten+2*n*vec);
+        }
+    }
+    add("velocityupd",2*n*vec+n*vec,2*n*vec);
+    add("viscosity",n*2*vec+ngbrwalk(2*vec)+n*vec,2*n*vec);
+    add("vorticity",n*2*vec+ngbrwalk(2*vec),n*vec);
+    if(ReorderInterval != 0){
+        add("reorder",2*n*record+n*index,2*n*record);
+    }
+}
+double FluidSolver::MeasureCopyBandwidth()
+{
+    uint32_t familycount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(PDevice,&familycount,nullptr);
+    std::vector<VkQueueFamilyProperties> families(familycount);
+    vkGetPhysicalDeviceQueueFamilyProperties(PDevice,&familycount,families.data());
+    uint32_t validbits = families[ComputeQueueFamily].timestampValidBits;
+    if(validbits == 0){
+        return 0.0;
+    }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(PDevice,&properties);
+    vkQueueWaitIdle(ComputeQueue);
+
+    //large enough to get past the caches,small enough for a software device
+    const VkDeviceSize size = 64ull<<20;
+    const uint32_t repeats = 8;
+    VkBuffer src,dst;
+    VkDeviceMemory srcmemory,dstmemory;
+    CreateBuffer(src,srcmemory,size,VK_BUFFER_USAGE_TRANSFER_SRC_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    CreateBuffer(dst,dstmemory,size,VK_BUFFER_USAGE_TRANSFER_SRC_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkQueryPool pool;
+    VkQueryPoolCreateInfo poolinfo{};
+    poolinfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolinfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolinfo.queryCount = 2;
+    if(vkCreateQueryPool(LDevice,&poolinfo,Allocator,&pool)!=VK_SUCCESS){
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    auto cb = CreateCommandBuffer();
+    vkCmdResetQueryPool(cb,pool,0,2);
+    VkMemoryBarrier copybarrier{};
+    copybarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    copybarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    copybarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    VkBufferCopy region{};
+    region.size = size;
+    //the first copy only warms up,the timestamps frame the rest
+    for(uint32_t i=0;i<=repeats;++i){
+        if(i == 1){
+            vkCmdWriteTimestamp(cb,VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,pool,0);
+        }
+        vkCmdCopyBuffer(cb,src,dst,1,&region);
+        vkCmdPipelineBarrier(cb,VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,0,1,&copybarrier,0,nullptr,0,nullptr);
+    }
+    vkCmdWriteTimestamp(cb,VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,pool,1);
+    VkSubmitInfo submitinfo{};
+    SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,ComputeQueue);
+
+    uint64_t timestamps[2];
+    vkGetQueryPoolResults(LDevice,pool,0,2,sizeof(timestamps),timestamps,sizeof(uint64_t),VK_QUERY_RESULT_64_BIT|VK_QUERY_RESULT_WAIT_BIT);
+    vkDestroyQueryPool(LDevice,pool,Allocator);
+    CleanupBuffer(src,srcmemory,false);
+    CleanupBuffer(dst,dstmemory,false);
+
+    uint64_t mask = validbits >= 64 ? ~0ull : (1ull<<validbits)-1;
+    double seconds = ((timestamps[1]-timestamps[0])&mask)*properties.limits.timestampPeriod*1e-9;
+    return seconds > 0 ? 2.0*size*repeats/seconds*1e-9 : 0.0;
+}
@@ -0,0 +1,270 @@
+#include"gpuprofiler.h"
+
+#include<exception>
+#include<stdexcept>
+#include<algorithm>
+
+#define Allocator nullptr
+void GpuProfiler::Init(VkPhysicalDevice pdevice,VkDevice ldevice,uint32_t queuefamily,uint32_t slotcount,bool pipelinestatistics)
+{
+    LDevice = ldevice;
+    uint32_t familycount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(pdevice,&familycount,nullptr);
+    std::vector<VkQueueFamilyProperties> families(familycount);
+    vkGetPhysicalDeviceQueueFamilyProperties(pdevice,&familycount,families.data());
+    uint32_t validbits = queuefamily < familycount ? families[queuefamily].timestampValidBits : 0;
+    if(validbits == 0){
+        bEnabled = false;
+        return;
+    }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(pdevice,&properties);
+    TimestampPeriod = properties.limits.timestampPeriod;
+    TimestampMask = validbits >= 64 ? ~0ull : (1ull<<validbits)-1;
+    bool graphics = (families[queuefamily].queueFlags&VK_QUEUE_GRAPHICS_BIT) != 0;
+    StatisticsFlags = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+    if(graphics){
+        StatisticsFlags |= VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT|VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    }
+    StatisticsCount = graphics ? 3 : 1;
+
+    slots.resize(slotcount);
+    for(auto& slot:slots){
+        VkQueryPoolCreateInfo createinfo{};
+        createinfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createinfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        createinfo.queryCount = MAX_SLOT_QUERIES;
+        if(vkCreateQueryPool(LDevice,&createinfo,Allocator,&slot.pool)!=VK_SUCCESS){
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+        if(pipelinestatistics){
+            createinfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            createinfo.pipelineStatistics = StatisticsFlags;
+            if(vkCreateQueryPool(LDevice,&createinfo,Allocator,&slot.statisticspool)!=VK_SUCCESS){
+                throw std::runtime_error("failed to create pipeline statistics query pool!");
+            }
+        }
+    }
+    results.resize(2*MAX_SLOT_QUERIES);
+    statistics.resize(4*MAX_SLOT_QUERIES);
+    bPipelineStatistics = pipelinestatistics;
+    bEnabled = true;
+}
+void GpuProfiler::Cleanup()
+{
+    for(auto& slot:slots){
+        vkDestroyQueryPool(LDevice,slot.pool,Allocator);
+        if(slot.statisticspool != VK_NULL_HANDLE){
+            vkDestroyQueryPool(LDevice,slot.statisticspool,Allocator);
+        }
+    }
+    slots.clear();
+    bEnabled = false;
+    bPipelineStatistics = false;
+}
+void GpuProfiler::RecordReset(VkCommandBuffer cb)
+{
+    for(auto& slot:slots){
+        vkCmdResetQueryPool(cb,slot.pool,0,MAX_SLOT_QUERIES);
+        if(bPipelineStatistics){
+            vkCmdResetQueryPool(cb,slot.statisticspool,0,MAX_SLOT_QUERIES);
+        }
+    }
+}
+
+void GpuProfiler::BeginSlot(VkCommandBuffer cb,uint32_t slot)
+{
+    if(!bEnabled){
+        return;
+    }
+    Slot& s = slots[slot];
+    //command buffers are only recorded again on an idle queue,results of the old recording left unread are dropped here
+    uint64_t first[2] = {0,0};
+    if(s.queries != 0 && vkGetQueryPoolResults(LDevice,s.pool,0,1,sizeof(first),first,sizeof(first),VK_QUERY_RESULT_64_BIT|VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) == VK_SUCCESS && first[1] != 0){
+        s.lastbegin = first[0];
+    }
+    s.stages.clear();
+    s.queries = 0;
+    s.bSubmitted = false;
+    vkCmdResetQueryPool(cb,s.pool,0,MAX_SLOT_QUERIES);
+    if(bPipelineStatistics){
+        vkCmdResetQueryPool(cb,s.statisticspool,0,MAX_SLOT_QUERIES);
+    }
+}
+void GpuProfiler::WriteTimestamp(VkCommandBuffer cb,uint32_t slot)
+{
+    Slot& s = slots[slot];
+    vkCmdWriteTimestamp(cb,VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,s.pool,s.queries);
+    ++s.queries;
+}
+void GpuProfiler::MarkStage(VkCommandBuffer cb,uint32_t slot,const std::string& name)
+{
+    if(!bEnabled){
+        return;
+    }
+    //one query stays free for EndSlot
+    if(slots[slot].queries+1 >= MAX_SLOT_QUERIES){
+        return;
+    }
+    //every timestamp waits for the commands before it,so it closes the last stage and opens this one
+    Slot& s = slots[slot];
+    if(bPipelineStatistics && !s.stages.empty()){
+        vkCmdEndQuery(cb,s.statisticspool,s.queries-1);
+    }
+    WriteTimestamp(cb,slot);
+    s.stages.push_back(GetStageIndex(name));
+    //stages begin and end outside render passes,so a query may span one
+    if(bPipelineStatistics){
+        vkCmdBeginQuery(cb,s.statisticspool,s.queries-1,0);
+    }
+}
+void GpuProfiler::EndSlot(VkCommandBuffer cb,uint32_t slot)
+{
+    if(!bEnabled || slots[slot].stages.empty()){
+        return;
+    }
+    if(bPipelineStatistics){
+        vkCmdEndQuery(cb,slots[slot].statisticspool,slots[slot].queries-1);
+    }
+    WriteTimestamp(cb,slot);
+}
+void GpuProfiler::MarkSubmitted(uint32_t slot)
+{
+    if(!bEnabled){
+        return;
+    }
+    slots[slot].bSubmitted = true;
+}
+uint32_t GpuProfiler::GetStageIndex(const std::string& name)
+{
+    auto it = stageindices.find(name);
+    if(it != stageindices.end()){
+        return it->second;
+    }
+    Stage stage;
+    stage.name = name;
+    stage.window.assign(WINDOW,0.0);
+    stages.push_back(stage);
+    uint32_t index = static_cast<uint32_t>(stages.size()-1);
+    stageindices[name] = index;
+    return index;
+}
+
+void GpuProfiler::Collect()
+{
+    if(!bEnabled){
+        return;
+    }
+    for(auto& s:slots){
+        if(!s.bSubmitted || s.stages.empty()){
+            continue;
+        }
+        //no wait bit,a slot still running answers VK_NOT_READY and is tried again next time
+        VkResult result = vkGetQueryPoolResults(LDevice,s.pool,0,s.queries,sizeof(uint64_t)*2*s.queries,results.data(),sizeof(uint64_t)*2,
+        VK_QUERY_RESULT_64_BIT|VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if(result != VK_SUCCESS && result != VK_NOT_READY){
+            throw std::runtime_error("failed to read timestamp queries!");
+        }
+        bool available = true;
+        for(uint32_t q=0;q<s.queries && available;++q){
+            available = results[2*q+1] != 0;
+        }
+        //a replay that has not started yet still holds the results taken last time
+        if(!available || results[0] == s.lastbegin){
+            continue;
+        }
+        //a replay that started in between can leave a mix of two runs,which shows up as time going backwards
+        bool ordered = true;
+        for(uint32_t q=1;q<s.queries && ordered;++q){
+            ordered = ((results[2*q]-results[2*(q-1)])&TimestampMask) <= (TimestampMask>>1);
+        }
+        if(!ordered){
+            continue;
+        }
+        //the statistics of a replay land no later than its closing timestamp
+        uint32_t stagecount = static_cast<uint32_t>(s.stages.size());
+        if(bPipelineStatistics){
+            uint32_t stride = StatisticsCount+1;
+            result = vkGetQueryPoolResults(LDevice,s.statisticspool,0,stagecount,sizeof(uint64_t)*stride*stagecount,statistics.data(),sizeof(uint64_t)*stride,
+            VK_QUERY_RESULT_64_BIT|VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+            if(result != VK_SUCCESS && result != VK_NOT_READY){
+                throw std::runtime_error("failed to read pipeline statistics queries!");
+            }
+            for(uint32_t k=0;k<stagecount && available;++k){
+                available = statistics[stride*k+StatisticsCount] != 0;
+            }
+            if(!available){
+                continue;
+            }
+        }
+        for(uint32_t k=0;k<stagecount;++k){
+            uint64_t ticks = (results[2*(k+1)]-results[2*k])&TimestampMask;
+            Stage& stage = stages[s.stages[k]];
+            //vertex,fragment,compute
+            if(bPipelineStatistics && StatisticsCount == 3){
+                std::copy(&statistics[4*k],&statistics[4*k+3],stage.invocations);
+            }
+            else if(bPipelineStatistics){
+                stage.invocations[2] = statistics[2*k];
+            }
+            stage.last = ticks*TimestampPeriod*1e-6;
+            stage.window[stage.next] = stage.last;
+            stage.next = (stage.next+1)%WINDOW;
+            ++stage.samples;
+        }
+        s.lastbegin = results[0];
+        s.bSubmitted = false;
+    }
+}
+
+void GpuProfiler::GetTimings(std::vector<GpuStageTiming>& timings) const
+{
+    timings.clear();
+    for(auto& stage:stages){
+        GpuStageTiming timing;
+        timing.name = stage.name;
+        timing.samples = stage.samples;
+        timing.last = stage.last;
+        timing.vertexinvocations = stage.invocations[0];
+        timing.fragmentinvocations = stage.invocations[1];
+        timing.computeinvocations = stage.invocations[2];
+        uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(stage.samples,WINDOW));
+        for(uint32_t i=0;i<count;++i){
+            timing.average += stage.window[i];
+        }
+        timing.average = count != 0 ? timing.average/count : 0.0;
+        timings.push_back(timing);
+    }
+}
+void GpuProfiler::ResetTimings()
+{
+    for(auto& stage:stages){
+        stage.window.assign(WINDOW,0.0);
+        stage.next = 0;
+        stage.samples = 0;
+        stage.last = 0;
+        std::fill(stage.invocations,stage.invocations+3,0);
+    }
+}
+void GpuProfiler::WriteCSV(std::ostream& out,const char* source) const
+{
+    std::vector<GpuStageTiming> timings;
+    GetTimings(timings);
+    for(auto& timing:timings){
+        out<<source<<","<<timing.name<<","<<timing.average<<","<<timing.last<<","<<timing.samples
+        <<","<<timing.vertexinvocations<<","<<timing.fragmentinvocations<<","<<timing.computeinvocations<<"\n";
+    }
+}
+void GpuProfiler::WriteJSON(std::ostream& out) const
+{
+    std::vector<GpuStageTiming> timings;
+    GetTimings(timings);
+    out<<"[";
+    for(uint32_t i=0;i<timings.size();++i){
+        out<<(i==0?"":",")<<"\n    {\"name\":\""<<timings[i].name<<"\",\"average_ms\":"<<timings[i].average
+        <<",\"last_ms\":"<<timings[i].last<<",\"samples\":"<<timings[i].samples
+        <<",\"vertex_invocations\":"<<timings[i].vertexinvocations<<",\"fragment_invocations\":"<<timings[i].fragmentinvocations
+        <<",\"compute_invocations\":"<<timings[i].computeinvocations<<"}";
+    }
+    out<<(timings.empty()?"]":"\n  ]");
+}
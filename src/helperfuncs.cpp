@@ -1,5 +1,7 @@
 #include "helperfuncs.h"
 #include<string>
+#include<cstring>
+#include<cmath>
 void HelperFuncs::ReadFile(const char *filename, std::vector<char>& bytes)
 {
     std::ifstream ifs;
@@ -14,4 +16,59 @@ void HelperFuncs::ReadFile(const char *filename, std::vector<char>& bytes)
     bytes.resize(size);
     ifs.read(bytes.data(),size);
     ifs.close();
-}
\ No newline at end of file
+}
+uint16_t HelperFuncs::FloatToHalf(float value)
+{
+    //round to nearest even,same as packHalf2x16 on the devices we run on
+    uint32_t bits;
+    memcpy(&bits,&value,sizeof(bits));
+    uint16_t sign = (bits>>16)&0x8000;
+    int32_t exponent = static_cast<int32_t>((bits>>23)&0xFF) - 127 + 15;
+    uint32_t mantissa = bits&0x7FFFFF;
+    if(((bits>>23)&0xFF) == 0xFF){
+        return sign|0x7C00|(mantissa?0x200:0);
+    }
+    if(exponent >= 31){
+        return sign|0x7C00;
+    }
+    if(exponent <= 0){
+        if(exponent < -10){
+            return sign;
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa>>shift;
+        uint32_t rest = mantissa&((1u<<shift)-1);
+        uint32_t halfway = 1u<<(shift-1);
+        if(rest > halfway || (rest == halfway && (half&1))){
+            ++half;
+        }
+        return sign|half;
+    }
+    uint32_t half = (exponent<<10)|(mantissa>>13);
+    uint32_t rest = mantissa&0x1FFF;
+    if(rest > 0x1000 || (rest == 0x1000 && (half&1))){
+        ++half;
+    }
+    return sign|half;
+}
+float HelperFuncs::HalfToFloat(uint16_t value)
+{
+    uint32_t sign = (value&0x8000)<<16;
+    uint32_t exponent = (value>>10)&0x1F;
+    uint32_t mantissa = value&0x3FF;
+    uint32_t bits;
+    if(exponent == 0){
+        float f = std::ldexp(static_cast<float>(mantissa),-24);
+        return sign?-f:f;
+    }
+    if(exponent == 31){
+        bits = sign|0x7F800000|(mantissa<<13);
+    }
+    else{
+        bits = sign|((exponent+127-15)<<23)|(mantissa<<13);
+    }
+    float f;
+    memcpy(&f,&bits,sizeof(f));
+    return f;
+}
@@ -1,5 +1,7 @@
 #include"renderer.h"
 #include"renderer_types.h"
+#include"cpufluidsolver.h"
+#include"cpuneighborsearch.h"
 #include"glm/gtc/matrix_transform.hpp"
 
 #include<iostream>
@@ -7,95 +9,514 @@
 #include<chrono>
 #include<string>
 #include<algorithm>
+#include<array>
+#include<cmath>
+#include<cctype>
 
 #undef APIENTRY
 #define NOMINMAX
 
 #define PI 3.1415926f
 
+struct Scene{
+    UniformSimulatingObject simulatingobj{};
+    UniformBoxInfoObject boxinfoobj{};
+    float accumulated_time = 0.0f;
+};
+
+//block of particles at rest in the lower half of the box
+std::vector<Particle> MakeBlock(float diam){
+    std::vector<Particle> particles;
+    for(float x=0.25;x<=0.75;x+=diam){
+        for(float z=0.25;z<=0.75;z+=diam){
+            for(float y=0.25;y<=0.75;y+=diam){
+                Particle particle{};
+                particle.Location = glm::vec3(x,y,z);
+
+                particle.Mass = 1;
+                particle.NumNgbrs = 0;
+                particles.push_back(particle);
+            }
+        }
+    }
+    return particles;
+}
+
+//the fluid and the box,shared by the gpu and the cpu solver
+void SetupSimulation(Scene& scene,float radius = 0.016f){
+    float diam = 2*radius;
+    UniformSimulatingObject& simulatingobj = scene.simulatingobj;
+    simulatingobj.dt = 1/240.0f;
+    simulatingobj.restDensity = 1.0f/(diam*diam*diam);
+    simulatingobj.sphRadius = 4*radius;
+
+    simulatingobj.coffPoly6 = 315.0f/(64*PI*pow(simulatingobj.sphRadius,3));
+    simulatingobj.coffGradSpiky = -45/(PI*pow(simulatingobj.sphRadius,4));
+    simulatingobj.coffSpiky = 15/(PI*pow(simulatingobj.sphRadius,3));
+
+    simulatingobj.scorrK = 0.0001;
+    simulatingobj.scorrQ = 0.1;
+    simulatingobj.scorrN = 4;
+
+    UniformBoxInfoObject& boxinfoobj = scene.boxinfoobj;
+    boxinfoobj.clampX = glm::vec2{0,1.5};
+    boxinfoobj.clampY = glm::vec2{0,1};
+    boxinfoobj.clampZ = glm::vec2{0,1};
+    boxinfoobj.clampX_still = glm::vec2{0,1.5};
+    boxinfoobj.clampY_still = glm::vec2{0,1};
+    boxinfoobj.clampZ_still = glm::vec2{0,1};
+}
+
+void SetupScene(Renderer& renderer,Scene& scene,float radius = 0.016f){
+    FluidSolver& solver = renderer.GetSolver();
+    float restDesity = 1000.0f;
+    float diam = 2*radius;
+
+    UniformRenderingObject renderingobj{};
+    renderingobj.model = glm::mat4(1.0f);
+    renderingobj.view = glm::lookAt(glm::vec3(1.5,1.3,1.5),glm::vec3(0,0.3,0),glm::vec3(0,1,0));
+    renderingobj.projection = glm::perspective(glm::radians(90.0f),1.0f,0.1f,10.0f);
+    renderingobj.projection[1][1]*=-1;
+    renderingobj.inv_projection = glm::inverse(renderingobj.projection);
+    renderingobj.zNear = 0.1f;
+    renderingobj.zFar = 10.0f;
+    renderingobj.aspect = 1;
+    renderingobj.fovy = glm::radians(90.0f);
+    renderingobj.particleRadius = radius; 
+    renderer.SetRenderingObj(renderingobj);
+    
+
+    SetupSimulation(scene,radius);
+    solver.SetSimulatingObj(scene.simulatingobj);
+    
+    UniformNSObject nsobj{};
+    nsobj.sphRadius = 4*radius;
+    solver.SetNSObj(nsobj);
+
+    solver.SetBoxinfoObj(scene.boxinfoobj);
+    //the whole box with some margin,only used by the compact layout
+    solver.SetCompactDomain(glm::vec3(-0.25f),2.0f);
+
+    solver.SetParticles(MakeBlock(diam));
+    solver.SetReorderInterval(16);
+}
+
+//count-1 more copies of the block in the same place,each stiffer than the last and behind a still wall
+//the domains share every dispatch of a step but never interact
+void AddSceneDomains(Renderer& renderer,Scene& scene,uint32_t count){
+    FluidSolver& solver = renderer.GetSolver();
+    float diam = 2*0.016f;
+    for(uint32_t i=1;i<count;++i){
+        UniformSimulatingObject simulatingobj = scene.simulatingobj;
+        simulatingobj.restDensity *= 1.0f+0.1f*i;
+        simulatingobj.scorrK *= static_cast<float>(i+1);
+        solver.AddDomain(MakeBlock(diam),simulatingobj,scene.boxinfoobj);
+    }
+}
+
+//a tap pouring 8x8 layers down into the middle of the box,one layer per diameter travelled
+void AddScenePour(Renderer& renderer,Scene& scene){
+    FluidSolver& solver = renderer.GetSolver();
+    float diam = 2*0.016f;
+    float speed = 1.0f;
+    solver.SetParticleCapacity(static_cast<uint32_t>(MakeBlock(diam).size())+32768);
+    ParticleEmitterObject emitter{};
+    emitter.origin = glm::vec3(0.5f,0.9f,0.5f);
+    emitter.spacing = diam;
+    emitter.velocity = glm::vec3(0,-speed,0);
+    emitter.side = 8;
+    emitter.interval = std::max(1u,static_cast<uint32_t>(diam/(speed*scene.simulatingobj.dt)));
+    emitter.mass = 1;
+    emitter.domain = 0;
+    solver.AddEmitter(emitter);
+}
+
+//a drain in one corner of the floor
+void AddSceneDrain(Renderer& renderer){
+    ParticleSinkObject sink{};
+    sink.boxMin = glm::vec3(-1.0f,-1.0f,-1.0f);
+    sink.boxMax = glm::vec3(0.15f,0.05f,0.15f);
+    renderer.GetSolver().AddSink(sink);
+}
+
+//advances the scene by steps steps of dt in one submission,the box moves once per batch
+//works on FluidSolver and CpuFluidSolver alike
+template<typename Solver>
+void StepScene(Solver& solver,Scene& scene,float dt,uint32_t steps = 1){
+    scene.accumulated_time += dt*steps;
+
+    scene.simulatingobj.dt = dt;
+    solver.SetSimulatingObj(scene.simulatingobj);
+
+    scene.boxinfoobj.clampX.y = 1+0.25*(1-glm::cos(5*scene.accumulated_time));
+    solver.SetBoxinfoObj(scene.boxinfoobj);
+    
+    solver.SimulateSteps(steps);
+}
+void StepScene(Renderer& renderer,Scene& scene,float dt,uint32_t steps = 1){
+    StepScene(renderer.GetSolver(),scene,dt,steps);
+}
+
+//rolling averages of every gpu stage,simulation first
+void PrintGpuTimings(Renderer& renderer){
+    std::vector<GpuStageTiming> timings;
+    std::array<const GpuProfiler*,2> profilers = {&renderer.GetSolver().GetProfiler(),&renderer.GetProfiler()};
+    std::array<const char*,2> sources = {"simulation","rendering"};
+    for(uint32_t i=0;i<profilers.size();++i){
+        profilers[i]->GetTimings(timings);
+        double total = 0;
+        for(auto& timing:timings){
+            printf("%-10s %-22s %8.3f ms (last %8.3f,%llu samples)\n",sources[i],timing.name.c_str(),timing.average,timing.last,static_cast<unsigned long long>(timing.samples));
+            total += timing.average;
+        }
+        if(!timings.empty()){
+            printf("%-10s %-22s %8.3f ms\n",sources[i],"total",total);
+        }
+    }
+}
+
+//stage timings next to their invocation counts and the bandwidth their estimated traffic implies
+void PrintStats(Renderer& renderer){
+    RendererStats stats;
+    renderer.GetStats(stats);
+    printf("%u particles,%.1f neighbors each,copy peak %.1f GB/s%s\n",stats.particles,stats.neighbors,stats.peakbandwidth,
+    stats.pipelinestatistics?"":",no pipeline statistics");
+    for(auto& stage:stats.stages){
+        const GpuStageTiming& timing = stage.timing;
+        unsigned long long invocations = timing.vertexinvocations+timing.fragmentinvocations+timing.computeinvocations;
+        double peak = stats.peakbandwidth>0 ? 100*stage.bandwidth/stats.peakbandwidth : 0;
+        printf("%-10s %-22s %8.3f ms %12llu inv %9.2f MB %8.1f GB/s %6.1f%% of peak\n",stage.source.c_str(),timing.name.c_str(),timing.average,
+        invocations,(stage.bytesread+stage.byteswritten)*1e-6,stage.bandwidth,peak);
+    }
+}
+
+//rms and max differences of two runs of the same scene,particles matched by upload order
+int ReportDrift(const char* title,const std::vector<Particle>& first,const std::vector<Particle>& second,uint32_t steps){
+    if(first.size() != second.size()){
+        printf("%s after %u steps,particle counts differ %zu vs %zu\n",title,steps,first.size(),second.size());
+        return EXIT_FAILURE;
+    }
+    double locationsqr = 0,locationmax = 0;
+    double velocitysqr = 0,velocitymax = 0;
+    double densityrel = 0;
+    size_t n = first.size();
+    for(size_t i=0;i<n;++i){
+        const Particle& a = first[i];
+        const Particle& b = second[i];
+        double dl = glm::length(a.Location-b.Location);
+        double dv = glm::length(a.Velocity-b.Velocity);
+        locationsqr += dl*dl;
+        velocitysqr += dv*dv;
+        locationmax = std::max(locationmax,dl);
+        velocitymax = std::max(velocitymax,dv);
+        densityrel += std::abs(a.Density-b.Density)/std::max(std::abs(a.Density),1e-6f);
+    }
+    printf("%s after %u steps,%zu particles\n",title,steps,n);
+    printf("location rms %e max %e\n",std::sqrt(locationsqr/n),locationmax);
+    printf("velocity rms %e max %e\n",std::sqrt(velocitysqr/n),velocitymax);
+    printf("density mean relative error %e\n",densityrel/n);
+    return EXIT_SUCCESS;
+}
+
+//runs the same scene with fp32 and compact particle storage and reports how far they drift apart
+int CompareLayouts(uint32_t steps){
+    std::array<ParticleLayout,2> layouts = {ParticleLayout::AOS,ParticleLayout::COMPACT};
+    std::array<std::vector<Particle>,2> results;
+    for(uint32_t i=0;i<layouts.size();++i){
+        Renderer renderer = Renderer(800,800,true);
+        Scene scene;
+        SetupScene(renderer,scene);
+        renderer.GetSolver().SetParticleLayout(layouts[i]);
+        renderer.Init();
+        for(uint32_t step=0;step<steps;++step){
+            StepScene(renderer,scene,1/240.0f);
+            auto result = renderer.TickWindow(1/240.0f);
+            if(result == TickWindowResult::EXIT){
+                break;
+            }
+            if(result != TickWindowResult::HIDE){
+                renderer.Draw();
+            }
+        }
+        renderer.GetSolver().GetParticles(results[i]);
+        renderer.Cleanup();
+    }
+
+    return ReportDrift("compact vs fp32",results[0],results[1],steps);
+}
+
+//runs the same scene on the gpu and on the cpu solver and reports how far they drift apart
+int CompareCpu(uint32_t steps){
+    std::vector<Particle> gpuresult,cpuresult;
+    {
+        Renderer renderer = Renderer(800,800,true);
+        renderer.SetHeadless(true);
+        Scene scene;
+        SetupScene(renderer,scene);
+        renderer.Init();
+        for(uint32_t step=0;step<steps;++step){
+            StepScene(renderer,scene,1/240.0f);
+        }
+        renderer.GetSolver().GetParticles(gpuresult);
+        renderer.Cleanup();
+    }
+    {
+        CpuFluidSolver solver;
+        Scene scene;
+        SetupSimulation(scene);
+        solver.SetSimulatingObj(scene.simulatingobj);
+        solver.SetBoxinfoObj(scene.boxinfoobj);
+        solver.SetParticles(MakeBlock(2*0.016f));
+        solver.Init();
+        for(uint32_t step=0;step<steps;++step){
+            StepScene(solver,scene,1/240.0f);
+        }
+        solver.GetParticles(cpuresult);
+        solver.Cleanup();
+    }
+    return ReportDrift("cpu vs gpu",cpuresult,gpuresult,steps);
+}
+
+//the default scene on the cpu solver only,no vulkan device is created
+int RunCpu(uint32_t steps){
+    CpuFluidSolver solver;
+    Scene scene;
+    SetupSimulation(scene);
+    solver.SetSimulatingObj(scene.simulatingobj);
+    solver.SetBoxinfoObj(scene.boxinfoobj);
+    solver.SetParticles(MakeBlock(2*0.016f));
+    solver.Init();
+    auto start = std::chrono::high_resolution_clock::now();
+    for(uint32_t step=0;step<steps;++step){
+        StepScene(solver,scene,1/240.0f);
+    }
+    float elapsed = std::chrono::duration<float,std::chrono::seconds::period>(std::chrono::high_resolution_clock::now()-start).count();
+    std::vector<Particle> particles;
+    solver.GetParticles(particles);
+    glm::vec3 center{0.0f};
+    for(auto& particle:particles){
+        center += particle.Location;
+    }
+    center /= std::max<size_t>(particles.size(),1);
+    printf("%u cpu steps,%zu particles in %f s,%u threads,%u simd lanes\n",steps,particles.size(),elapsed,solver.GetThreadCount(),CpuFluidSolver::GetSimdWidth());
+    printf("center of mass %f %f %f\n",center.x,center.y,center.z);
+    solver.Cleanup();
+    return EXIT_SUCCESS;
+}
+
+//times the radixsort and the counting sort cell build on the dense grid from the profiler stages,the block side sets the particle count
+//then the host neighbor search over the settled particles,grid and lists,the part of a step the sorts feed
+int BenchSort(uint32_t steps){
+    std::array<uint32_t,3> sides = {40,64,101};
+    std::array<RadixsortMode,2> modes = {RadixsortMode::AUTO,RadixsortMode::COUNTING};
+    std::array<const char*,2> names = {"radixsort","counting"};
+    const uint32_t warmup = 16;
+    WorkerPool pool;
+    for(uint32_t side:sides){
+        std::vector<Particle> settled;
+        for(uint32_t i=0;i<modes.size();++i){
+            Renderer renderer = Renderer(800,800,false);
+            renderer.SetHeadless(true);
+            renderer.SetProfiling(true);
+            Scene scene;
+            //MakeBlock spans half the box
+            SetupScene(renderer,scene,0.25f/(side-1));
+            FluidSolver& solver = renderer.GetSolver();
+            solver.SetCellIndexMode(CellIndexMode::DENSE);
+            solver.SetRadixsortMode(modes[i]);
+            renderer.Init();
+            for(uint32_t step=0;step<warmup;++step){
+                StepScene(renderer,scene,1/240.0f);
+            }
+            solver.WaitIdle();
+            solver.ResetProfiler();
+            for(uint32_t step=0;step<steps;++step){
+                StepScene(renderer,scene,1/240.0f);
+            }
+            solver.WaitIdle();
+            if(!solver.GetProfiler().IsEnabled()){
+                throw std::runtime_error("the compute queue has no timestamps to time the sort with!");
+            }
+            //only the stages from the cell clear to the fixed up cell buffer,the rest of the step does not depend on the sort
+            std::vector<GpuStageTiming> timings;
+            solver.GetProfiler().GetTimings(timings);
+            double total = 0;
+            for(auto& timing:timings){
+                if(timing.name.starts_with("cell") || timing.name.starts_with("radixsort") || timing.name == "calcellhash"
+                || timing.name == "sort clear" || timing.name == "fixcellbuffer"){
+                    printf("%-9s %8u particles %-22s %8.3f ms\n",names[i],solver.GetParticleCount(),timing.name.c_str(),timing.average);
+                    total += timing.average;
+                }
+            }
+            printf("%-9s %8u particles %-22s %8.3f ms/step\n",names[i],solver.GetParticleCount(),"sort and cell build",total);
+            solver.GetParticles(settled);
+            renderer.Cleanup();
+        }
+        CpuNeighborSearch search(&pool);
+        std::vector<uint32_t> offsets,ngbrs;
+        float sphRadius = 4*0.25f/(side-1);
+        auto start = std::chrono::high_resolution_clock::now();
+        for(uint32_t step=0;step<steps;++step){
+            search.Build(settled,sphRadius);
+            search.BuildNeighborLists(sphRadius,offsets,ngbrs);
+        }
+        float elapsed = std::chrono::duration<float,std::milli>(std::chrono::high_resolution_clock::now()-start).count();
+        printf("%-9s %8zu particles %8.3f ms/search,%u threads\n","cpu",settled.size(),elapsed/steps,pool.GetThreadCount());
+    }
+    return EXIT_SUCCESS;
+}
+
 int main(int argc,char** argv){
     
     try{
-        float radius = 0.016;
-        float restDesity = 1000.0f;
-        float diam = 2*radius;
+        for(int i=1;i<argc;++i){
+            if(std::string(argv[i]) == "--compare-layouts"){
+                uint32_t steps = i+1<argc&&std::isdigit(argv[i+1][0])?std::stoul(argv[i+1]):600;
+                return CompareLayouts(steps);
+            }
+            if(std::string(argv[i]) == "--compare-cpu"){
+                uint32_t steps = i+1<argc&&std::isdigit(argv[i+1][0])?std::stoul(argv[i+1]):600;
+                return CompareCpu(steps);
+            }
+            if(std::string(argv[i]) == "--cpu"){
+                uint32_t steps = i+1<argc&&std::isdigit(argv[i+1][0])?std::stoul(argv[i+1]):600;
+                return RunCpu(steps);
+            }
+            if(std::string(argv[i]) == "--bench-sort"){
+                uint32_t steps = i+1<argc&&std::isdigit(argv[i+1][0])?std::stoul(argv[i+1]):200;
+                return BenchSort(steps);
+            }
+        }
 
         Renderer renderer = Renderer(800,800,true);
-
-        UniformRenderingObject renderingobj{};
-        renderingobj.model = glm::mat4(1.0f);
-        renderingobj.view = glm::lookAt(glm::vec3(1.5,1.3,1.5),glm::vec3(0,0.3,0),glm::vec3(0,1,0));
-        renderingobj.projection = glm::perspective(glm::radians(90.0f),1.0f,0.1f,10.0f);
-        renderingobj.projection[1][1]*=-1;
-        renderingobj.inv_projection = glm::inverse(renderingobj.projection);
-        renderingobj.zNear = 0.1f;
-        renderingobj.zFar = 10.0f;
-        renderingobj.aspect = 1;
-        renderingobj.fovy = glm::radians(90.0f);
-        renderingobj.particleRadius = radius; 
-        renderer.SetRenderingObj(renderingobj);
-        
-
-        UniformSimulatingObject simulatingobj{};
-        simulatingobj.dt = 1/240.0f;
-        simulatingobj.restDensity = 1.0f/(diam*diam*diam);
-        simulatingobj.sphRadius = 4*radius;
-
-        simulatingobj.coffPoly6 = 315.0f/(64*PI*pow(simulatingobj.sphRadius,3));
-        simulatingobj.coffGradSpiky = -45/(PI*pow(simulatingobj.sphRadius,4));
-        simulatingobj.coffSpiky = 15/(PI*pow(simulatingobj.sphRadius,3));
-
-        simulatingobj.scorrK = 0.0001;
-        simulatingobj.scorrQ = 0.1;
-        simulatingobj.scorrN = 4;
-        renderer.SetSimulatingObj(simulatingobj);
-        
-        UniformNSObject nsobj{};
-        nsobj.sphRadius = 4*radius;
-        renderer.SetNSObj(nsobj);
-
-        UniformBoxInfoObject boxinfoobj{};
-        boxinfoobj.clampX = glm::vec2{0,1.5};
-        boxinfoobj.clampY = glm::vec2{0,1};
-        boxinfoobj.clampZ = glm::vec2{0,1};
-        boxinfoobj.clampX_still = glm::vec2{0,1.5};
-        boxinfoobj.clampY_still = glm::vec2{0,1};
-        boxinfoobj.clampZ_still = glm::vec2{0,1};
-        renderer.SetBoxinfoObj(boxinfoobj);
-
-        std::vector<Particle> particles;
-        for(float x=0.25;x<=0.75;x+=diam){
-            for(float z=0.25;z<=0.75;z+=diam){
-                for(float y=0.25;y<=0.75;y+=diam){
-                    Particle particle{};
-                    particle.Location = glm::vec3(x,y,z);
-
-                    particle.Mass = 1;
-                    particle.NumNgbrs = 0;
-                    particles.push_back(particle);
+        Scene scene;
+        SetupScene(renderer,scene);
+        FluidSolver& solver = renderer.GetSolver();
+        //0:wall clock dt,1:fixed dt with an accumulator,2:offline,fixed dt as fast as possible
+        int timestepmode = 0;
+        float fixeddt = 1/240.0f;
+        uint32_t stepsperdraw = 1;
+        //0:windowed,otherwise the number of steps simulated without a window
+        uint32_t headlesssteps = 0;
+        //where --profile dumps the gpu stage timings on exit,empty without profiling
+        std::string profilepath;
+        bool statsmode = false;
+        for(int i=1;i<argc;++i){
+            if(std::string(argv[i]) == "--headless"){
+                renderer.SetHeadless(true);
+                headlesssteps = i+1<argc&&std::isdigit(argv[i+1][0])?std::stoul(argv[i+1]):600;
+            }
+            if(std::string(argv[i]) == "--fixed-dt"){
+                timestepmode = 1;
+            }
+            if(std::string(argv[i]) == "--offline"){
+                timestepmode = 2;
+                stepsperdraw = i+1<argc&&std::isdigit(argv[i+1][0])?std::stoul(argv[i+1]):8;
+                if(stepsperdraw == 0){
+                    throw std::runtime_error("--offline needs at least one step per draw!");
                 }
             }
+            if(std::string(argv[i]) == "--cell-walk"){
+                solver.SetNeighborMode(NeighborMode::CELLWALK);
+            }
+            if(std::string(argv[i]) == "--compact-ngbrs"){
+                solver.SetNeighborMode(NeighborMode::COMPACTLIST);
+            }
+            if(std::string(argv[i]) == "--fused-solver"){
+                solver.SetFusedSolver(true);
+            }
+            if(std::string(argv[i]) == "--iterations" && i+1<argc && std::isdigit(argv[i+1][0])){
+                solver.SetSolverIterations(std::stoul(argv[i+1]));
+            }
+            if(std::string(argv[i]) == "--substeps" && i+1<argc && std::isdigit(argv[i+1][0])){
+                solver.SetSubsteps(std::stoul(argv[i+1]));
+            }
+            if(std::string(argv[i]) == "--domains" && i+1<argc && std::isdigit(argv[i+1][0])){
+                AddSceneDomains(renderer,scene,std::stoul(argv[i+1]));
+            }
+            if(std::string(argv[i]) == "--dense-grid"){
+                solver.SetCellIndexMode(CellIndexMode::DENSE);
+            }
+            if(std::string(argv[i]) == "--morton-grid"){
+                solver.SetCellIndexMode(CellIndexMode::MORTON);
+            }
+            if(std::string(argv[i]) == "--skin"){
+                //a quarter of the kernel radius of SetupScene unless given
+                solver.SetNeighborSkin(i+1<argc&&std::isdigit(argv[i+1][0])?std::stof(argv[i+1]):0.016f);
+            }
+            if(std::string(argv[i]) == "--counting-sort"){
+                solver.SetRadixsortMode(RadixsortMode::COUNTING);
+            }
+            if(std::string(argv[i]) == "--pour"){
+                AddScenePour(renderer,scene);
+            }
+            if(std::string(argv[i]) == "--drain"){
+                AddSceneDrain(renderer);
+            }
+            if(std::string(argv[i]) == "--profile"){
+                renderer.SetProfiling(true);
+                profilepath = i+1<argc&&argv[i+1][0]!='-'?argv[i+1]:"gpu_timings.csv";
+            }
+            if(std::string(argv[i]) == "--stats"){
+                renderer.SetStatistics(true);
+                statsmode = true;
+            }
         }
-        renderer.SetParticles(particles);
 
-        float accumulated_time = 0.0f;
         renderer.Init();
+        if(headlesssteps != 0){
+            auto start = std::chrono::high_resolution_clock::now();
+            for(uint32_t step=0;step<headlesssteps;++step){
+                StepScene(renderer,scene,fixeddt);
+            }
+            std::vector<Particle> particles;
+            solver.GetParticles(particles);
+            float elapsed = std::chrono::duration<float,std::chrono::seconds::period>(std::chrono::high_resolution_clock::now()-start).count();
+            glm::vec3 center{0.0f};
+            for(auto& particle:particles){
+                center += particle.Location;
+            }
+            center /= std::max<size_t>(particles.size(),1);
+            printf("%u headless steps,%zu particles in %f s\n",headlesssteps,particles.size(),elapsed);
+            printf("center of mass %f %f %f\n",center.x,center.y,center.z);
+            printf("%u neighbor searches\n",solver.GetNeighborRebuildCount());
+            if(statsmode){
+                PrintStats(renderer);
+            }
+            else if(!profilepath.empty()){
+                renderer.WaitIdle();
+                PrintGpuTimings(renderer);
+            }
+            if(!profilepath.empty()){
+                renderer.WriteGpuTimings(profilepath);
+            }
+            renderer.Cleanup();
+            return EXIT_SUCCESS;
+        }
         auto now = std::chrono::high_resolution_clock::now();
+        float accumulator = 0.0f;
         for(;;){
             auto last = now;
             now = std::chrono::high_resolution_clock::now();
             float deltatime = std::chrono::duration<float,std::chrono::seconds::period>(now-last).count();
 
-            float dt = std::clamp(deltatime,1/360.0f,1/60.0f);
-            accumulated_time += dt;
-
-            simulatingobj.dt = dt;
-            renderer.SetSimulatingObj(simulatingobj);
-
-            boxinfoobj.clampX.y = 1+0.25*(1-glm::cos(5*accumulated_time));
-            renderer.SetBoxinfoObj(boxinfoobj);
-            
-            renderer.Simulate();
+            if(timestepmode == 0){
+                float dt = std::clamp(deltatime,1/360.0f,1/60.0f);
+                StepScene(renderer,scene,dt);
+            }
+            else if(timestepmode == 1){
+                //drop what is left after a long stall instead of spiraling
+                const uint32_t maxsteps = 8;
+                accumulator += deltatime;
+                uint32_t steps = std::min(static_cast<uint32_t>(accumulator/fixeddt),maxsteps);
+                accumulator = steps==maxsteps ? 0.0f : accumulator-steps*fixeddt;
+                if(steps != 0){
+                    StepScene(renderer,scene,fixeddt,steps);
+                }
+            }
+            else{
+                StepScene(renderer,scene,fixeddt,stepsperdraw);
+            }
 
             auto result = renderer.TickWindow(deltatime);
             
@@ -109,6 +530,16 @@ int main(int argc,char** argv){
             printf("%f\n",1/deltatime);
         }
 
+        if(statsmode){
+            PrintStats(renderer);
+        }
+        else if(!profilepath.empty()){
+            renderer.WaitIdle();
+            PrintGpuTimings(renderer);
+        }
+        if(!profilepath.empty()){
+            renderer.WriteGpuTimings(profilepath);
+        }
         renderer.Cleanup();
     }
     catch(std::runtime_error err){
@@ -12,6 +12,8 @@
 #include<set>
 #include<array>
 #include<algorithm>
+#include<bit>
+#include<fstream>
 
 
 #define Allocator nullptr
@@ -316,51 +318,119 @@ void Renderer::SetRenderingObj(const UniformRenderingObject &robj)
     }
 
 }
-void Renderer::SetSimulatingObj(const UniformSimulatingObject &sobj)
+void Renderer::SetHeadless(bool headless)
 {
     if(Initialized){
-        vkQueueWaitIdle(GraphicNComputeQueue);
-        auto pObj = reinterpret_cast<UniformSimulatingObject*>(MappedSimulatingBuffer);
-        pObj->dt = sobj.dt;
-        pObj->accumulated_t = sobj.accumulated_t;
-    }
-    else{
-        simulatingobj = sobj;
+        throw std::runtime_error("you should not set headless after vulkan initialized!");
     }
+    bHeadless = headless;
 }
-
-void Renderer::SetNSObj(const UniformNSObject &nobj)
+void Renderer::SetProfiling(bool profiling)
 {
     if(Initialized){
-         vkQueueWaitIdle(GraphicNComputeQueue);
-        memcpy(MappedNSBuffer,&nobj,sizeof(UniformNSObject));
-    }
-    else{
-        nsobject = nobj;
+        throw std::runtime_error("you should not set profiling after vulkan initialized!");
     }
+    bProfiling = profiling;
+    Solver.SetProfiling(profiling);
 }
-
-void Renderer::SetBoxinfoObj(const UniformBoxInfoObject &bobj)
+void Renderer::SetPreferredDevice(const std::string& name)
 {
     if(Initialized){
-        vkQueueWaitIdle(GraphicNComputeQueue);
-        memcpy(MappedBoxInfoBuffer,&bobj,sizeof(UniformBoxInfoObject));
+        throw std::runtime_error("you should not set preferred device after vulkan initialized!");
     }
-    else{
-        boxinfobj = bobj;
+    PreferredDevice = name;
+}
+VkPhysicalDeviceProperties Renderer::GetDeviceProperties()
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(PDevice,&properties);
+    return properties;
+}
+void Renderer::SetStatistics(bool statistics)
+{
+    if(Initialized){
+        throw std::runtime_error("you should not set statistics after vulkan initialized!");
+    }
+    bStatistics = statistics;
+    if(statistics){
+        SetProfiling(true);
+    }
+}
+//pairs every profiled stage with its estimated traffic by name
+static void AddStageStats(RendererStats& stats,const char* source,const GpuProfiler& profiler,const std::vector<GpuStageTraffic>& traffic)
+{
+    std::vector<GpuStageTiming> timings;
+    profiler.GetTimings(timings);
+    for(auto& timing:timings){
+        GpuStageStats stage;
+        stage.source = source;
+        stage.timing = timing;
+        auto it = std::find_if(traffic.begin(),traffic.end(),[&](const GpuStageTraffic& t){ return t.name == timing.name; });
+        if(it != traffic.end()){
+            stage.bytesread = it->bytesread;
+            stage.byteswritten = it->byteswritten;
+        }
+        if(timing.average > 0){
+            stage.bandwidth = (stage.bytesread+stage.byteswritten)/(timing.average*1e-3)*1e-9;
+        }
+        stats.stages.push_back(stage);
     }
 }
+void Renderer::GetStats(RendererStats& stats)
+{
+    WaitIdle();
+    stats = RendererStats{};
+    stats.particles = Solver.GetParticleCount();
+    stats.neighbors = Solver.GetMeanNeighborCount();
+    //the copy only runs once,it would show up in the timings of the next steps otherwise
+    if(PeakBandwidth == 0){
+        PeakBandwidth = Solver.MeasureCopyBandwidth();
+    }
+    stats.peakbandwidth = PeakBandwidth;
+    stats.pipelinestatistics = bPipelineStatistics;
 
-void Renderer::SetParticles(const std::vector<Particle> &ps)
+    std::vector<GpuStageTraffic> traffic;
+    Solver.GetStageTraffic(stats.particles,stats.neighbors,traffic);
+    AddStageStats(stats,"simulation",Solver.GetProfiler(),traffic);
+    if(bHeadless){
+        return;
+    }
+    //the attachments and the filtered depth are one fp32 channel each
+    double pixels = static_cast<double>(SwapChainImageExtent.width)*SwapChainImageExtent.height;
+    double fragments = pixels;
+    std::vector<GpuStageTiming> timings;
+    Profiler.GetTimings(timings);
+    for(auto& timing:timings){
+        if(timing.name == "splat" && timing.fragmentinvocations != 0){
+            fragments = static_cast<double>(timing.fragmentinvocations);
+        }
+    }
+    traffic.clear();
+    traffic.push_back({"splat",static_cast<double>(stats.particles)*Particle::GetBinding(Solver.GetParticleLayout()).stride,fragments*2*sizeof(float)});
+    //21x21 taps around every pixel
+    traffic.push_back({"bilateral filter",pixels*441*sizeof(float),pixels*sizeof(float)});
+    //depth,thickness and two background reads,one rgba8 write
+    traffic.push_back({"postprocess",pixels*4*sizeof(float),pixels*sizeof(uint32_t)});
+    AddStageStats(stats,"rendering",Profiler,traffic);
+}
+void Renderer::WriteGpuTimings(const std::string& path)
 {
-    if(Initialized){
-        throw std::runtime_error("you should not set particles after vulkan initialized!");
+    std::ofstream out(path);
+    if(!out){
+        throw std::runtime_error("failed to open "+path+"!");
     }
-    else if(ps.size()>=ONE_GROUP_INVOCATION_COUNT*ONE_GROUP_INVOCATION_COUNT){
-       throw std::runtime_error("num of particles is too big!");
+    bool json = path.size() >= 5 && path.compare(path.size()-5,5,".json") == 0;
+    if(json){
+        out<<"{\n  \"simulation\":";
+        Solver.GetProfiler().WriteJSON(out);
+        out<<",\n  \"rendering\":";
+        Profiler.WriteJSON(out);
+        out<<"\n}\n";
     }
     else{
-        particles.assign(ps.begin(),ps.end());
+        out<<"source,stage,average_ms,last_ms,samples,vertex_invocations,fragment_invocations,compute_invocations\n";
+        Solver.GetProfiler().WriteCSV(out,"simulation");
+        Profiler.WriteCSV(out,"rendering");
     }
 }
 Renderer::Renderer(uint32_t w, uint32_t h, bool validation)
@@ -376,56 +446,67 @@ Renderer::~Renderer()
 }
 void Renderer::Init()
 {
-    glfwInit();
-    glfwWindowHint(GLFW_RESIZABLE,GLFW_FALSE);
-    glfwWindowHint(GLFW_CLIENT_API,GLFW_NO_API);
-    Window = glfwCreateWindow(Width,Height,"jason's renderer",nullptr,nullptr);
-    glfwSetWindowUserPointer(Window,this);
-    glfwSetFramebufferSizeCallback(Window,&Renderer::WindowResizeCallback);
+    if(!bHeadless){
+        glfwInit();
+        glfwWindowHint(GLFW_RESIZABLE,GLFW_FALSE);
+        glfwWindowHint(GLFW_CLIENT_API,GLFW_NO_API);
+        Window = glfwCreateWindow(Width,Height,"jason's renderer",nullptr,nullptr);
+        glfwSetWindowUserPointer(Window,this);
+        glfwSetFramebufferSizeCallback(Window,&Renderer::WindowResizeCallback);
+    }
     CreateInstance();
     CreateDebugMessenger();
-    CreateSurface();
+    if(!bHeadless){
+        CreateSurface();
+    }
     PickPhysicalDevice();
     CreateLogicalDevice();
 
     CreateSupportObjects();
     CreateCommandPool();
 
-    CreateParticleBuffer();
-    CreateParticleNgbrBuffer();
- 
-    CreateRadixsortedIndexBuffer();
-    CreateRSGlobalBucketBuffer();
-    CreateCellinfoBuffer();
-    CreateLocalPrefixBuffer();
-    
-    CreateUniformNSBuffer();
-    CreateUniformRenderingBuffer();
-    CreateUniformSimulatingBuffer();
-    CreateUniformBoxInfoBuffer();
-
-    CreateSwapChain();
-    CreateDepthResources();
-    CreateThickResources();
-    CreateDefaultTextureResources();
-    CreateBackgroundResources();
-
-
-    CreateDescriptorSetLayout();
-    CreateDescriptorPool();
-    CreateDescriptorSet();
-    CreateRenderPass();
-    CreateGraphicPipelineLayout();
-    CreateGraphicPipeline();
-  
-    CreateComputePipelineLayout();
-    CreateComputePipeline();
-   
-    CreateFramebuffers(); 
+    FluidSolverContext context{};
+    context.PDevice = PDevice;
+    context.LDevice = LDevice;
+    context.ComputeQueue = GraphicNComputeQueue;
+    context.ComputeQueueFamily = GetPhysicalDeviceQueueFamilyIndices(PDevice).graphicNcompute.value();
+    context.PipelineStatistics = bPipelineStatistics;
+    Solver.Init(context);
+
+    //headless stops at the solver,see SetHeadless
+    if(!bHeadless){
+        CreateUniformRenderingBuffer();
+
+        CreateSwapChain();
+        CreateDepthResources();
+        CreateThickResources();
+        CreateDefaultTextureResources();
+        CreateBackgroundResources();
+
+        CreateDescriptorSetLayout();
+        CreateDescriptorPool();
+        CreateDescriptorSet();
+        CreateRenderPass();
+        CreateGraphicPipelineLayout();
+        CreateGraphicPipeline();
+
+        CreateComputePipelineLayout();
+        CreateComputePipeline();
+
+        CreateFramebuffers();
+
+        //a slot per fluids rendering command buffer
+        if(bProfiling){
+            Profiler.Init(PDevice,LDevice,context.ComputeQueueFamily,2*static_cast<uint32_t>(SwapChainImages.size()),bPipelineStatistics);
+            auto cb = CreateCommandBuffer();
+            Profiler.RecordReset(cb);
+            VkSubmitInfo submitinfo{};
+            SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,GraphicNComputeQueue);
+        }
 
-    RecordSimulatingCommandBuffers();
-    RecordFluidsRenderingCommandBuffers();
-    RecordBoxRenderingCommandBuffers();
+        RecordFluidsRenderingCommandBuffers();
+        RecordBoxRenderingCommandBuffers();
+    }
 
     Initialized = true;
 }
@@ -433,35 +514,36 @@ void Renderer::Cleanup()
 {
     vkDeviceWaitIdle(LDevice);
 
-    vkFreeCommandBuffers(LDevice,CommandPool,MAXInFlightRendering,SimulatingCommandBuffers.data());
-    for(uint32_t i=0;i<2;++i)
-        vkFreeCommandBuffers(LDevice,CommandPool,SwapChainImages.size(),FluidsRenderingCommandBuffers[i].data());
-    vkFreeCommandBuffers(LDevice,CommandPool,1,&BoxRenderingCommandBuffer);
-    
-    vkDestroyPipeline(LDevice,NSPipeline_CalcellHash,Allocator);
-    vkDestroyPipeline(LDevice,NSPipeline_Radixsort1,Allocator);
-    vkDestroyPipeline(LDevice,NSPipeline_Radixsort2,Allocator);
-    vkDestroyPipeline(LDevice,NSPipeline_Radixsort3,Allocator);
-    vkDestroyPipeline(LDevice,NSPipeline_FixcellBuffer,Allocator);
-    vkDestroyPipeline(LDevice,NSPipeline_GetNgbrs,Allocator);
+    Solver.Cleanup();
+    if(!bHeadless){
+        Profiler.Cleanup();
+        CleanupGraphicObjects();
+    }
 
+    vkDestroyCommandPool(LDevice,CommandPool,Allocator);
+    CleanupSupportObjects();
 
-    vkDestroyPipeline(LDevice,SimulatePipeline_Euler,Allocator);
-    vkDestroyPipeline(LDevice,SimulatePipeline_Lambda,Allocator);
-    vkDestroyPipeline(LDevice,SimulatePipeline_DeltaPosition,Allocator);
-    vkDestroyPipeline(LDevice,SimulatePipeline_PositionUpd,Allocator);
-    vkDestroyPipeline(LDevice,SimulatePipeline_VelocityUpd,Allocator);
-    vkDestroyPipeline(LDevice,SimulatePipeline_VelocityCache,Allocator);
-    vkDestroyPipeline(LDevice,SimulatePipeline_ViscosityCorr,Allocator);
-    vkDestroyPipeline(LDevice,SimulatePipeline_VorticityCorr,Allocator);
-    vkDestroyPipelineLayout(LDevice,SimulatePipelineLayout,Allocator);
+    vkDestroyDevice(LDevice,Allocator);
+    if(!bHeadless){
+        vkDestroySurfaceKHR(Instance,Surface,Allocator);
+    }
+    ExtensionFuncs::vkDestroyDebugUtilsMessengerEXT(Instance,Messenger,Allocator);
+    vkDestroyInstance(Instance,Allocator);
 
+    if(!bHeadless){
+        glfwDestroyWindow(Window);
+        glfwTerminate();
+    }
+}
+void Renderer::CleanupGraphicObjects()
+{
+    for(uint32_t i=0;i<2;++i)
+        vkFreeCommandBuffers(LDevice,CommandPool,SwapChainImages.size(),FluidsRenderingCommandBuffers[i].data());
+    vkFreeCommandBuffers(LDevice,CommandPool,1,&BoxRenderingCommandBuffer);
 
     vkDestroyPipeline(LDevice,PostprocessPipeline,Allocator);
-    vkDestroyPipelineLayout(LDevice,PostprocessPipelineLayout,Allocator);
 
     vkDestroyPipeline(LDevice,FilterPipeline,Allocator);
-    vkDestroyPipelineLayout(LDevice,FilterPipelineLayout,Allocator);
     
     vkDestroyPipeline(LDevice,FluidGraphicPipeline,Allocator);
     vkDestroyPipelineLayout(LDevice,FluidGraphicPipelineLayout,Allocator);
@@ -471,18 +553,18 @@ void Renderer::Cleanup()
     vkDestroyPipelineLayout(LDevice,BoxGraphicPipelineLayout,Allocator);
     vkDestroyRenderPass(LDevice,BoxGraphicRenderPass,Allocator);
 
-
-    vkDestroyPipelineLayout(LDevice,NSPipelineLayout,Allocator);
+    vkDestroyPipelineLayout(LDevice,PostprocessPipelineLayout,Allocator);
+    vkDestroyPipelineLayout(LDevice,FilterPipelineLayout,Allocator);
 
     vkDestroyDescriptorPool(LDevice,DescriptorPool,Allocator);
 
     vkDestroyDescriptorSetLayout(LDevice,BoxGraphicDescriptorSetLayout,Allocator);
     vkDestroyDescriptorSetLayout(LDevice,FluidGraphicDescriptorSetLayout,Allocator); 
-    vkDestroyDescriptorSetLayout(LDevice,SimulateDescriptorSetLayout,Allocator);
     vkDestroyDescriptorSetLayout(LDevice,FilterDecsriptorSetLayout,Allocator);
     vkDestroyDescriptorSetLayout(LDevice,PostprocessDescriptorSetLayout,Allocator);
-    vkDestroyDescriptorSetLayout(LDevice,NSDescriptorSetLayout,Allocator);
-    
+
+    CleanupBuffer(UniformRenderingBuffer,UniformRenderingBufferMemory,true);
+
     vkDestroyFramebuffer(LDevice,FluidsFramebuffer,Allocator);
     vkDestroyFramebuffer(LDevice,BoxFramebuffer,Allocator);
 
@@ -516,39 +598,13 @@ void Renderer::Cleanup()
     vkFreeMemory(LDevice,BackgroundImageMemory,Allocator);
 
     CleanupSwapChain();
-
-
-    for(uint32_t i=0;i<MAXInFlightRendering;++i){
-        CleanupBuffer(ParticleBuffers[i],ParticleBufferMemory[i],false);
-    }
-    CleanupBuffer(ParticleNgbrBuffer,ParticleNgbrBufferMemory,false);
-    CleanupBuffer(UniformRenderingBuffer,UniformRenderingBufferMemory,true);
-    CleanupBuffer(UniformSimulatingBuffer,UniformSimulatingBufferMemory,true);
-    CleanupBuffer(UniformNSBuffer,UniformNSBufferMemory,true);
-    CleanupBuffer(UniformBoxInfoBuffer,UniformBoxInfoBufferMemory,true);
-    for(uint32_t i=0;i<2;++i){
-        CleanupBuffer(RadixsortedIndexBuffer[i],RadixsortedIndexBufferMemory[i],false);
-    }
-    CleanupBuffer(RSGlobalBucketBuffer,RSGlobalBucketBufferMemory,false);
-    CleanupBuffer(CellinfoBuffer,CellinfoBufferMemory,false);
-    CleanupBuffer(LocalPrefixBuffer,LocalPrefixBufferMemory,false);
-
-    vkDestroyCommandPool(LDevice,CommandPool,Allocator);
-    CleanupSupportObjects();
-
-    vkDestroyDevice(LDevice,Allocator);
-    vkDestroySurfaceKHR(Instance,Surface,Allocator);
-    ExtensionFuncs::vkDestroyDebugUtilsMessengerEXT(Instance,Messenger,Allocator);
-    vkDestroyInstance(Instance,Allocator);
-
-    glfwDestroyWindow(Window);
-    glfwTerminate();
 }
 void Renderer::CreateInstance()
 {
     VkApplicationInfo appinfo{};
     appinfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     appinfo.pApplicationName = "Jason's Renderer";
+    appinfo.apiVersion = VK_API_VERSION_1_1;
     
     VkInstanceCreateInfo createinfo{};
     createinfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -583,9 +639,6 @@ void Renderer::CreateSupportObjects(){
     if(vkCreateSemaphore(LDevice,&seminfo,Allocator,&BoxRenderingFinish)!=VK_SUCCESS){
         throw std::runtime_error("failed to create sem:filteringfinish!");
     }
-    if(vkCreateSemaphore(LDevice,&seminfo,Allocator,&SimulatingFinish)!=VK_SUCCESS){
-        throw std::runtime_error("failed to create sem:simulatingfinsh!");
-    }
     VkFenceCreateInfo fenceinfo{};
     fenceinfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceinfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
@@ -599,7 +652,6 @@ void Renderer::CleanupSupportObjects()
     vkDestroySemaphore(LDevice,ImageAvaliable,Allocator);
     vkDestroySemaphore(LDevice,FluidsRenderingFinish,Allocator);
     vkDestroySemaphore(LDevice,BoxRenderingFinish,Allocator);
-    vkDestroySemaphore(LDevice,SimulatingFinish,Allocator);
     vkDestroyFence(LDevice,DrawingFence,Allocator);
     
 }
@@ -624,13 +676,19 @@ void Renderer::PickPhysicalDevice()
     std::vector<VkPhysicalDevice> pdeives(pdevice_count);
     vkEnumeratePhysicalDevices(Instance,&pdevice_count,pdeives.data());
     for(auto& pdevice:pdeives){
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(pdevice,&properties);
+        if(!PreferredDevice.empty() && std::string(properties.deviceName).find(PreferredDevice) == std::string::npos){
+            continue;
+        }
         if(IsPhysicalDeviceSuitable(pdevice)){
             PDevice = pdevice;
-            return;
+            break;
         }
     }
-    throw std::runtime_error("failed to find a suitable physical device!");
-
+    if(PDevice == VK_NULL_HANDLE){
+        throw std::runtime_error("failed to find a suitable physical device!");
+    }
 }
 void Renderer::CreateLogicalDevice()
 {
@@ -666,6 +724,7 @@ void Renderer::CreateLogicalDevice()
     if(vkCreateDevice(PDevice,&createinfo,Allocator,&LDevice)!=VK_SUCCESS){
         throw std::runtime_error("failed to create logical device!");
     }
+    bPipelineStatistics = features.pipelineStatisticsQuery == VK_TRUE;
     vkGetDeviceQueue(LDevice,queueindices.graphicNcompute.value(),0,&GraphicNComputeQueue);
     vkGetDeviceQueue(LDevice,queueindices.present.value(),0,&PresentQueue);
 }
@@ -680,55 +739,6 @@ void Renderer::CreateCommandPool()
         throw std::runtime_error("failed to create command pool!");
     }
 }
-void Renderer::CreateParticleBuffer()
-{
-    if(particles.size()%ONE_GROUP_INVOCATION_COUNT != 0){
-        WORK_GROUP_COUNT = particles.size()/ONE_GROUP_INVOCATION_COUNT + 1;
-    }
-    else{
-        WORK_GROUP_COUNT = particles.size()/ONE_GROUP_INVOCATION_COUNT;
-    }
-    nsobject.numParticles = particles.size();
-    nsobject.workgroup_count = WORK_GROUP_COUNT;
-    nsobject.hashsize = particles.size()*2;
-
-    simulatingobj.numParticles = particles.size();
-
-    ParticleBufferMemory.resize(MAXInFlightRendering);
-    ParticleBuffers.resize(MAXInFlightRendering);
-    VkDeviceSize size = particles.size()*sizeof(Particle);
-
-    for(uint32_t i=0;i<MAXInFlightRendering;++i){
-        VkBuffer stagingbuffer;
-        VkDeviceMemory stagingmemory;
-        CreateBuffer(stagingbuffer,stagingmemory,size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        CreateBuffer(ParticleBuffers[i],ParticleBufferMemory[i],size,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT|VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        void* data;
-        vkMapMemory(LDevice,stagingmemory,0,size,0,&data);
-        memcpy(data,particles.data(),size);
-        
-        auto cb = CreateCommandBuffer();
-        VkBufferCopy region{};
-        region.size = size;
-        region.dstOffset = region.srcOffset = 0;
-        vkCmdCopyBuffer(cb,stagingbuffer,ParticleBuffers[i],1,&region);
-        VkSubmitInfo submitinfo{};
-        SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,GraphicNComputeQueue);
-        
-        vkDeviceWaitIdle(LDevice);
-        CleanupBuffer(stagingbuffer,stagingmemory,true);
-    }
-}
-
-void Renderer::CreateParticleNgbrBuffer()
-{
-    VkDeviceSize size = MAX_NGBR_NUM*particles.size()*sizeof(uint32_t);
-    CreateBuffer(ParticleNgbrBuffer,ParticleNgbrBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-}
-
 void Renderer::CreateUniformRenderingBuffer()
 {
     VkDeviceSize size = sizeof(UniformRenderingObject);
@@ -737,84 +747,6 @@ void Renderer::CreateUniformRenderingBuffer()
     vkMapMemory(LDevice,UniformRenderingBufferMemory,0,size,0,&MappedRenderingBuffer);
     memcpy(MappedRenderingBuffer,&renderingobj,size);
 }
-
-void Renderer::CreateUniformSimulatingBuffer()
-{
-    VkDeviceSize size = sizeof(UniformSimulatingObject);
-    CreateBuffer(UniformSimulatingBuffer,UniformSimulatingBufferMemory,size,
-    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    vkMapMemory(LDevice,UniformSimulatingBufferMemory,0,size,0,&MappedSimulatingBuffer);
-    memcpy(MappedSimulatingBuffer,&simulatingobj,size);
-}
-
-void Renderer::CreateUniformNSBuffer()
-{
-    VkDeviceSize size = sizeof(UniformNSObject);
-    CreateBuffer(UniformNSBuffer,UniformNSBufferMemory,size,
-    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    vkMapMemory(LDevice,UniformNSBufferMemory,0,size,0,&MappedNSBuffer);
-    memcpy(MappedNSBuffer,&nsobject,size);
-}
-
-void Renderer::CreateUniformBoxInfoBuffer()
-{
-    VkDeviceSize size = sizeof(UniformBoxInfoObject);
-    CreateBuffer(UniformBoxInfoBuffer,UniformBoxInfoBufferMemory,size,
-    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    vkMapMemory(LDevice,UniformBoxInfoBufferMemory,0,size,0,&MappedBoxInfoBuffer);
-    memcpy(MappedBoxInfoBuffer,&boxinfobj,size);
-}
-
-void Renderer::CreateRadixsortedIndexBuffer()
-{
-    VkDeviceSize size = sizeof(uint32_t)*particles.size();
-    for(uint32_t i=0;i<2;++i){
-        VkBuffer stagingbuffer;
-        VkDeviceMemory stagingmemory;
-        CreateBuffer(stagingbuffer,stagingmemory,size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT|VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        CreateBuffer(RadixsortedIndexBuffer[i],RadixsortedIndexBufferMemory[i],size,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        void* data;
-        vkMapMemory(LDevice,stagingmemory,0,size,0,&data);
-        int* intdata = reinterpret_cast<int*>(data);
-        for(uint32_t j=0;j<size/4;++j)
-        {
-            intdata[j] = j;
-        }
-        
-        auto cb = CreateCommandBuffer();
-        VkBufferCopy region{};
-        region.size = size;
-        region.dstOffset = region.srcOffset = 0;
-        vkCmdCopyBuffer(cb,stagingbuffer,RadixsortedIndexBuffer[i],1,&region);
-        VkSubmitInfo submitinfo{};
-        SubmitCommandBuffer(cb,submitinfo,VK_NULL_HANDLE,GraphicNComputeQueue);
-        
-        vkDeviceWaitIdle(LDevice);
-        CleanupBuffer(stagingbuffer,stagingmemory,true);
-    }
-}
-
-void Renderer::CreateRSGlobalBucketBuffer()
-{
-    VkDeviceSize size = sizeof(uint32_t)*(WORK_GROUP_COUNT+1)*16;
-    CreateBuffer(RSGlobalBucketBuffer,RSGlobalBucketBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-}
-
-void Renderer::CreateCellinfoBuffer()
-{
-    VkDeviceSize size = sizeof(uint32_t)*4*particles.size();
-    CreateBuffer(CellinfoBuffer,CellinfoBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-}
-
-void Renderer::CreateLocalPrefixBuffer()
-{
-    VkDeviceSize size = sizeof(uint32_t)*16*particles.size();
-    CreateBuffer(LocalPrefixBuffer,LocalPrefixBufferMemory,size,VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-}
-
 void Renderer::CreateDepthResources()
 {
     VkExtent3D extent = {SwapChainImageExtent.width,SwapChainImageExtent.height,1};
@@ -1083,42 +1015,6 @@ void Renderer::CreateDescriptorSetLayout()
         }
     }
 
-    {
-        std::array<VkDescriptorSetLayoutBinding,5> bindings{};
-        bindings[0].binding = 0;
-        bindings[0].descriptorCount = 1;
-        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[1].binding = 1;
-        bindings[1].descriptorCount = 1;
-        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[2].binding = 2;
-        bindings[2].descriptorCount = 1;
-        bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[3].binding = 3;
-        bindings[3].descriptorCount = 1;
-        bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[3].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[4].binding = 4;
-        bindings[4].descriptorCount = 1;
-        bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        VkDescriptorSetLayoutCreateInfo createinfo{};
-        createinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        createinfo.bindingCount = static_cast<uint32_t>(bindings.size());
-        createinfo.pBindings = bindings.data();
-
-        if(vkCreateDescriptorSetLayout(LDevice,&createinfo,Allocator,&SimulateDescriptorSetLayout)!=VK_SUCCESS){
-            throw std::runtime_error("failed to create simulate descriptor set layout!");
-        }
-    }
     {
         std::array<VkDescriptorSetLayoutBinding,5> bindings{};
 
@@ -1176,58 +1072,6 @@ void Renderer::CreateDescriptorSetLayout()
             throw std::runtime_error("failed to create filter descriptor set layout!");
         }
     }
-    {
-        std::array<VkDescriptorSetLayoutBinding,8> bindings{};
-        bindings[0].binding = 0;
-        bindings[0].descriptorCount = 1;
-        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[1].binding = 1;
-        bindings[1].descriptorCount = 1;
-        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[2].binding = 2;
-        bindings[2].descriptorCount = 1;
-        bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[3].binding = 3;
-        bindings[3].descriptorCount = 1;
-        bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[3].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[4].binding = 4;
-        bindings[4].descriptorCount = 1;
-        bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[5].binding = 5;
-        bindings[5].descriptorCount = 1;
-        bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[5].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[6].binding = 6;
-        bindings[6].descriptorCount = 1;
-        bindings[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[6].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        bindings[7].binding = 7;
-        bindings[7].descriptorCount = 1;
-        bindings[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        bindings[7].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-
-        VkDescriptorSetLayoutCreateInfo createinfo{};
-        createinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        createinfo.bindingCount = static_cast<uint32_t>(bindings.size());
-        createinfo.pBindings = bindings.data();
-        if(vkCreateDescriptorSetLayout(LDevice,&createinfo,Allocator,&NSDescriptorSetLayout)!=VK_SUCCESS){
-            throw std::runtime_error("failed to create neighborhood searcher descriptor set layout!");
-        }
-
-    }
 }
 void Renderer::CreateDescriptorPool()
 {
@@ -1236,7 +1080,7 @@ void Renderer::CreateDescriptorPool()
     poolsizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     poolsizes[1].descriptorCount = 64;
     poolsizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolsizes[2].descriptorCount = 64;
+    poolsizes[2].descriptorCount = 128;
     poolsizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     poolsizes[3].descriptorCount = 64;
     poolsizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
@@ -1297,7 +1141,7 @@ void Renderer::CreateDescriptorSet()
         renderingbufferinfo.range = sizeof(UniformRenderingObject);
         
         VkDescriptorBufferInfo boxinfobufferinfo{};
-        boxinfobufferinfo.buffer = UniformBoxInfoBuffer;
+        boxinfobufferinfo.buffer = Solver.GetBoxInfoBuffer();
         boxinfobufferinfo.offset = 0;
         boxinfobufferinfo.range = sizeof(UniformBoxInfoObject);
 
@@ -1332,220 +1176,6 @@ void Renderer::CreateDescriptorSet()
 
         vkUpdateDescriptorSets(LDevice,writes.size(),writes.data(),0,nullptr);
     }
-    {
-        SimulateDescriptorSet.resize(MAXInFlightRendering);
-        VkDescriptorSetAllocateInfo allocateinfo{};
-        allocateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocateinfo.descriptorPool = DescriptorPool;
-        allocateinfo.descriptorSetCount = 1;
-        allocateinfo.pSetLayouts = &SimulateDescriptorSetLayout;
-        for(uint32_t i=0;i<MAXInFlightRendering;++i){
-            if(vkAllocateDescriptorSets(LDevice,&allocateinfo,&SimulateDescriptorSet[i])!=VK_SUCCESS){
-                throw std::runtime_error("failed to allocate simulate descriptor set!");
-            }
-        }
-        std::array<VkWriteDescriptorSet,5> writes{};
-
-        VkDescriptorBufferInfo simulatingbufferinfo{};
-        simulatingbufferinfo.buffer = UniformSimulatingBuffer;
-        simulatingbufferinfo.offset = 0;
-        simulatingbufferinfo.range = sizeof(UniformSimulatingObject);
-
-        VkDescriptorBufferInfo ngbrbufferinfo{};
-        ngbrbufferinfo.buffer = ParticleNgbrBuffer;
-        ngbrbufferinfo.offset = 0;
-        ngbrbufferinfo.range = MAX_NGBR_NUM*particles.size()*sizeof(uint32_t);
-
-        VkDescriptorBufferInfo boxbufferinfo{};
-        boxbufferinfo.buffer = UniformBoxInfoBuffer;
-        boxbufferinfo.offset = 0;
-        boxbufferinfo.range = sizeof(UniformBoxInfoObject);
-        
-        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[0].descriptorCount = 1;
-        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        writes[0].dstArrayElement = 0;
-        writes[0].dstBinding = 0;
-        writes[0].pBufferInfo = &simulatingbufferinfo;
-            
-        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[1].descriptorCount = 1;
-        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[1].dstArrayElement = 0;
-        writes[1].dstBinding = 1;
-
-        writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[2].descriptorCount = 1;
-        writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[2].dstArrayElement = 0;
-        writes[2].dstBinding = 2; 
-
-        writes[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[3].descriptorCount = 1;
-        writes[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[3].dstArrayElement = 0;
-        writes[3].dstBinding = 3;
-        writes[3].pBufferInfo = &ngbrbufferinfo;
-
-        writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[4].descriptorCount = 1;
-        writes[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        writes[4].dstArrayElement = 0;
-        writes[4].dstBinding = 4;
-        writes[4].pBufferInfo = &boxbufferinfo;
-
-    
-
-        for(uint32_t i=0;i<MAXInFlightRendering;++i){
-           
-            VkDescriptorBufferInfo particlebufferinfo_thisframe{};
-            particlebufferinfo_thisframe.buffer = ParticleBuffers[i];
-            particlebufferinfo_thisframe.offset = 0;
-            particlebufferinfo_thisframe.range = sizeof(Particle)*particles.size();
-            VkDescriptorBufferInfo particlebufferinfo_lastframe{};
-            particlebufferinfo_lastframe.buffer = ParticleBuffers[(i-1)%MAXInFlightRendering];
-            particlebufferinfo_lastframe.offset = 0;
-            particlebufferinfo_lastframe.range = sizeof(Particle)*particles.size();
-            
-            writes[0].dstSet = SimulateDescriptorSet[i];
-            writes[1].dstSet = SimulateDescriptorSet[i];
-            writes[1].pBufferInfo = &particlebufferinfo_lastframe;
-            writes[2].dstSet = SimulateDescriptorSet[i];
-            writes[2].pBufferInfo =  &particlebufferinfo_thisframe;
-            writes[3].dstSet = SimulateDescriptorSet[i];
-            writes[4].dstSet = SimulateDescriptorSet[i];
-            
-            vkUpdateDescriptorSets(LDevice,writes.size(),writes.data(),0,nullptr);
-        }
-    }
-
-    {
-        for(uint32_t i=0;i<2;++i){
-            NSDescriptorSets[i].resize(MAXInFlightRendering);
-        }
-        for(uint32_t i=0;i<2;++i){
-            for(uint32_t j=0;j<MAXInFlightRendering;++j){
-                VkDescriptorSetAllocateInfo allocateinfo{};
-                allocateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-                allocateinfo.descriptorSetCount = 1;
-                allocateinfo.descriptorPool = DescriptorPool;
-                allocateinfo.pSetLayouts = &NSDescriptorSetLayout;
-                if(vkAllocateDescriptorSets(LDevice,&allocateinfo,&NSDescriptorSets[i][j])!=VK_SUCCESS){
-                    throw std::runtime_error("failed to allocate neighborhood searcher desciptorset!");
-                }
-            }
-        }
-
-        VkDescriptorBufferInfo nsbufferinfo{};
-        nsbufferinfo.buffer = UniformNSBuffer;
-        nsbufferinfo.offset = 0;
-        nsbufferinfo.range = sizeof(UniformNSObject);
-
-        VkDescriptorBufferInfo sortedidxbufferinfo[2]{};
-        sortedidxbufferinfo[0].buffer = RadixsortedIndexBuffer[0];
-        sortedidxbufferinfo[0].offset = 0;
-        sortedidxbufferinfo[0].range = sizeof(uint32_t)*particles.size();
-        sortedidxbufferinfo[1].buffer = RadixsortedIndexBuffer[1];
-        sortedidxbufferinfo[1].offset = 0;
-        sortedidxbufferinfo[1].range = sizeof(uint32_t)*particles.size();
-
-        VkDescriptorBufferInfo pngbrebufferinfo{};
-        pngbrebufferinfo.buffer = ParticleNgbrBuffer;
-        pngbrebufferinfo.offset = 0;
-        pngbrebufferinfo.range = MAX_NGBR_NUM*particles.size()*sizeof(uint32_t);
-
-        VkDescriptorBufferInfo rsbucketbufferinfo{};
-        rsbucketbufferinfo.buffer = RSGlobalBucketBuffer;
-        rsbucketbufferinfo.offset = 0;
-        rsbucketbufferinfo.range = sizeof(uint32_t)*16*(WORK_GROUP_COUNT+1);
-
-        VkDescriptorBufferInfo cellinfobufferinfo{};
-        cellinfobufferinfo.buffer = CellinfoBuffer;
-        cellinfobufferinfo.offset = 0;
-        cellinfobufferinfo.range = sizeof(uint32_t)*4*particles.size();
-
-        VkDescriptorBufferInfo localprefixbufferinfo{};
-        localprefixbufferinfo.buffer = LocalPrefixBuffer;
-        localprefixbufferinfo.offset = 0;
-        localprefixbufferinfo.range = sizeof(uint32_t)*16*particles.size();
-
-        std::array<VkWriteDescriptorSet,8> writes{};
-        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[0].descriptorCount = 1;
-        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        writes[0].dstArrayElement = 0;
-        writes[0].dstBinding = 0;
-        writes[0].pBufferInfo = &nsbufferinfo;
-
-        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[1].descriptorCount = 1;
-        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[1].dstArrayElement = 0;
-        writes[1].dstBinding = 1;
-
-        writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[2].descriptorCount = 1;
-        writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[2].dstArrayElement = 0;
-        writes[2].dstBinding = 2;
-
-        writes[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[3].descriptorCount = 1;
-        writes[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[3].dstArrayElement = 0;
-        writes[3].dstBinding = 3;
-        
-        writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[4].descriptorCount = 1;
-        writes[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[4].dstArrayElement = 0;
-        writes[4].dstBinding = 4;
-        writes[4].pBufferInfo = &pngbrebufferinfo;
-
-        writes[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[5].descriptorCount = 1;
-        writes[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[5].dstArrayElement = 0;
-        writes[5].dstBinding = 5;
-        writes[5].pBufferInfo = &rsbucketbufferinfo;
-
-        writes[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[6].descriptorCount = 1;
-        writes[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[6].dstArrayElement = 0;
-        writes[6].dstBinding = 6;
-        writes[6].pBufferInfo = &cellinfobufferinfo;
-
-        writes[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[7].descriptorCount = 1;
-        writes[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writes[7].dstArrayElement = 0;
-        writes[7].dstBinding = 7;
-        writes[7].pBufferInfo = &localprefixbufferinfo;
-
-        for(uint32_t i=0;i<2;++i){
-            writes[1].pBufferInfo = &sortedidxbufferinfo[i];
-            writes[2].pBufferInfo = &sortedidxbufferinfo[i^1];
-            for(uint32_t j=0;j<MAXInFlightRendering;++j){
-                VkDescriptorBufferInfo particlebufferinfo{};
-                particlebufferinfo.buffer = ParticleBuffers[j];
-                particlebufferinfo.offset = 0;
-                particlebufferinfo.range = particles.size()*sizeof(Particle);
-                writes[3].pBufferInfo = &particlebufferinfo;
-
-                writes[0].dstSet = NSDescriptorSets[i][j];
-                writes[1].dstSet = NSDescriptorSets[i][j];
-                writes[2].dstSet = NSDescriptorSets[i][j];
-                writes[3].dstSet = NSDescriptorSets[i][j];
-                writes[4].dstSet = NSDescriptorSets[i][j];
-                writes[5].dstSet = NSDescriptorSets[i][j];
-                writes[6].dstSet = NSDescriptorSets[i][j];
-                writes[7].dstSet = NSDescriptorSets[i][j];
-
-                vkUpdateDescriptorSets(LDevice,static_cast<uint32_t>(writes.size()),writes.data(),0,nullptr);
-            }
-        }
-    }
 
     {
         PostprocessDescriptorSets.resize(SwapChainImages.size());
@@ -1705,13 +1335,15 @@ void Renderer::CreateGraphicPipelineLayout()
 }
 void Renderer::CreateGraphicPipeline()
 {
-    auto fluidvertshadermodule = MakeShaderModule("resources/shaders/spv/fluidvertshader.spv");
+    auto fluidvertshadermodule = MakeShaderModule(Solver.GetParticleLayout() == ParticleLayout::COMPACT?
+        "resources/shaders/spv/fluidvertshader_compact.spv":"resources/shaders/spv/fluidvertshader.spv");
     auto fluidfragshadermodule = MakeShaderModule("resources/shaders/spv/fluidfragshader.spv");
     VkPipelineShaderStageCreateInfo fluidvertshader{};
     fluidvertshader.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fluidvertshader.module = fluidvertshadermodule;
     fluidvertshader.pName = "main";
     fluidvertshader.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    fluidvertshader.pSpecializationInfo = Solver.GetParticleSpecialization();
     VkPipelineShaderStageCreateInfo fluidfragshader{};
     fluidfragshader.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fluidfragshader.module = fluidfragshadermodule;
@@ -1743,8 +1375,8 @@ void Renderer::CreateGraphicPipeline()
 
     VkPipelineVertexInputStateCreateInfo fluidvertexinput{};
     fluidvertexinput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    auto fluidvertexinputbinding = Particle::GetBinding();
-    auto fluidvertexinputattributes = Particle::GetAttributes();
+    auto fluidvertexinputbinding = Particle::GetBinding(Solver.GetParticleLayout());
+    auto fluidvertexinputattributes = Particle::GetAttributes(Solver.GetParticleLayout());
     fluidvertexinput.vertexBindingDescriptionCount = 1;
     fluidvertexinput.pVertexBindingDescriptions = &fluidvertexinputbinding;
     fluidvertexinput.vertexAttributeDescriptionCount = static_cast<uint32_t>(fluidvertexinputattributes.size());
@@ -1891,20 +1523,6 @@ void Renderer::CreateGraphicPipeline()
 }
 void Renderer::CreateComputePipelineLayout()
 {
-    VkPipelineLayoutCreateInfo nscreateinfo{};
-    nscreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    nscreateinfo.pSetLayouts = &NSDescriptorSetLayout;
-    nscreateinfo.setLayoutCount = 1;
-    if(vkCreatePipelineLayout(LDevice,&nscreateinfo,Allocator,&NSPipelineLayout)!=VK_SUCCESS){
-        throw std::runtime_error("failed to create neighborhood searcher pipeline layout!");
-    }
-    VkPipelineLayoutCreateInfo simulatecreateinfo{};
-    simulatecreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    simulatecreateinfo.pSetLayouts = &SimulateDescriptorSetLayout;
-    simulatecreateinfo.setLayoutCount = 1;
-    if(vkCreatePipelineLayout(LDevice,&simulatecreateinfo,Allocator,&SimulatePipelineLayout)!=VK_SUCCESS){
-        throw std::runtime_error("failed to create simulate pipeline layout!");
-    }
     VkPipelineLayoutCreateInfo postprocesscreateinfo{};
     postprocesscreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     postprocesscreateinfo.pSetLayouts = &PostprocessDescriptorSetLayout;
@@ -1922,77 +1540,6 @@ void Renderer::CreateComputePipelineLayout()
 }
 void Renderer::CreateComputePipeline()
 {
-    {
-        //NGBR PIPELINES
-        auto computeshadermodule_calcellhash = MakeShaderModule("resources/shaders/spv/compshader_calcellhash.spv");
-        auto computeshadermodule_radixsort1 = MakeShaderModule("resources/shaders/spv/compshader_radixsort1.spv");
-        auto computeshadermodule_radixsort2 = MakeShaderModule("resources/shaders/spv/compshader_radixsort2.spv");
-        auto computeshadermodule_radixsort3 = MakeShaderModule("resources/shaders/spv/compshader_radixsort3.spv");
-        auto computeshadermodule_fixcellbuffer = MakeShaderModule("resources/shaders/spv/compshader_fixcellbuffer.spv");
-        auto computeshadermodule_getngbrs = MakeShaderModule("resources/shaders/spv/compshader_getngbrs.spv");
-
-        std::vector<VkShaderModule> shadermodules = {computeshadermodule_calcellhash,computeshadermodule_radixsort1,computeshadermodule_radixsort2,
-        computeshadermodule_radixsort3,computeshadermodule_fixcellbuffer,computeshadermodule_getngbrs};
-        std::vector<VkPipeline*> pcomputepipelines = {&NSPipeline_CalcellHash,&NSPipeline_Radixsort1,&NSPipeline_Radixsort2,
-        &NSPipeline_Radixsort3,&NSPipeline_FixcellBuffer,&NSPipeline_GetNgbrs}; 
-        
-        for(uint32_t i=0;i<shadermodules.size();++i){
-            VkPipelineShaderStageCreateInfo stageinfo{};
-            stageinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-            stageinfo.pName = "main";
-            stageinfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-            stageinfo.module = shadermodules[i];
-            VkComputePipelineCreateInfo createinfo{};
-            createinfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-            createinfo.layout = NSPipelineLayout;
-            createinfo.stage = stageinfo;
-            if(vkCreateComputePipelines(LDevice,VK_NULL_HANDLE,1,&createinfo,Allocator,pcomputepipelines[i])!=VK_SUCCESS){
-                throw std::runtime_error("failed to create ns compute pipeline!");
-            }
-        }
-
-        for(auto& computershadermodule:shadermodules){
-            vkDestroyShaderModule(LDevice,computershadermodule,Allocator);
-        }
-    }
-
-    {
-        //SIMULATING PIPELINES
-        auto computershadermodule_euler = MakeShaderModule("resources/shaders/spv/compshader_euler.spv");
-        auto computershadermodule_lambda = MakeShaderModule("resources/shaders/spv/compshader_lambda.spv");
-        auto computershadermodule_deltaposition = MakeShaderModule("resources/shaders/spv/compshader_deltaposition.spv");
-        auto computershadermodule_positionupd = MakeShaderModule("resources/shaders/spv/compshader_positionupd.spv");
-        auto computershadermodule_velocityupd = MakeShaderModule("resources/shaders/spv/compshader_velocityupd.spv");
-        auto computershadermodule_velocitycache = MakeShaderModule("resources/shaders/spv/compshader_velocitycache.spv");
-        auto computershadermodule_viscositycorr = MakeShaderModule("resources/shaders/spv/compshader_viscositycorr.spv");
-        auto computershadermodule_vorticitycorr = MakeShaderModule("resources/shaders/spv/compshader_vorticitycorr.spv");
-
-        std::vector<VkShaderModule> shadermodules = {computershadermodule_euler,computershadermodule_lambda,computershadermodule_deltaposition,
-        computershadermodule_positionupd,computershadermodule_velocityupd,computershadermodule_velocitycache,
-        computershadermodule_viscositycorr,computershadermodule_vorticitycorr};
-        std::vector<VkPipeline*> pcomputepipelines = {&SimulatePipeline_Euler,&SimulatePipeline_Lambda,&SimulatePipeline_DeltaPosition,
-        &SimulatePipeline_PositionUpd,&SimulatePipeline_VelocityUpd, 
-        &SimulatePipeline_VelocityCache,&SimulatePipeline_ViscosityCorr, &SimulatePipeline_VorticityCorr};
-
-        for(uint32_t i=0;i<shadermodules.size();++i){
-            VkPipelineShaderStageCreateInfo stageinfo{};
-            stageinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-            stageinfo.pName = "main";
-            stageinfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-            stageinfo.module = shadermodules[i];
-            VkComputePipelineCreateInfo createinfo{};
-            createinfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-            createinfo.layout = SimulatePipelineLayout;
-            createinfo.stage = stageinfo;
-            if(vkCreateComputePipelines(LDevice,VK_NULL_HANDLE,1,&createinfo,Allocator,pcomputepipelines[i])!=VK_SUCCESS){
-                throw std::runtime_error("failed to create simulating compute pipeline!");
-            }
-        }
-
-        for(auto& computershadermodule:shadermodules){
-            vkDestroyShaderModule(LDevice,computershadermodule,Allocator);
-        }
-    }
     {
         //POSTPROCESSING PIPELINES
         auto computershadermodule_postprocessing = MakeShaderModule("resources/shaders/spv/compshader_postprocessing.spv");
@@ -2063,122 +1610,6 @@ void Renderer::CreateFramebuffers()
         throw std::runtime_error("failed to create box framebuffer!");
     }
 }
-void Renderer::RecordSimulatingCommandBuffers()
-{
-    SimulatingCommandBuffers.resize(MAXInFlightRendering);
-    for(uint32_t i=0;i<MAXInFlightRendering;++i){
-        VkCommandBufferAllocateInfo allocateinfo{};
-        allocateinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocateinfo.commandPool = CommandPool;
-        allocateinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocateinfo.commandBufferCount = 1;
-        if(vkAllocateCommandBuffers(LDevice,&allocateinfo,&SimulatingCommandBuffers[i])!=VK_SUCCESS){
-            throw std::runtime_error("failed to allocate simulating command buffer!");
-        }
-        VkCommandBufferBeginInfo begininfo{};
-        begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        begininfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-
-        if(vkBeginCommandBuffer(SimulatingCommandBuffers[i],&begininfo)!=VK_SUCCESS){
-            throw std::runtime_error("failed to begin simulating command buffer!");
-        }
-        VkMemoryBarrier memorybarrier{};
-        memorybarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-        memorybarrier.srcAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
-        memorybarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
-        memorybarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-        memorybarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT|VK_ACCESS_SHADER_WRITE_BIT;
-
-        
-        vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipelineLayout,0,1,&SimulateDescriptorSet[i],0,nullptr);
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
-        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_Euler);
-        vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);
-        
-        ////////////////////////////////////////////////////////////////////////////////////////////////////
-        //                  SEARCHING NEIGHBORS
-        ////////////////////////////////////////////////////////////////////////////////////////////////////
-        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_CalcellHash);
-        vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipelineLayout,0,1,&NSDescriptorSets[0][i],0,nullptr);
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
-        vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);
-        
-        for(uint32_t iter=0;iter<8;++iter){
-            vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipelineLayout,0,1,&NSDescriptorSets[iter%2][i],0,nullptr);
-
-            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_Radixsort1);
-            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
-            vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);
-
-            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_Radixsort2);
-            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
-            vkCmdDispatch(SimulatingCommandBuffers[i],1,1,1);
-
-            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_Radixsort3);
-            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
-            vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);
-
-        }
-        
-        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_FixcellBuffer);
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
-        vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);
-
-        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,NSPipeline_GetNgbrs);
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
-        vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);
-        ////////////////////////////////////////////////////////////////////////////////////////////////////
-
-        vkCmdBindDescriptorSets(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipelineLayout,0,1,&SimulateDescriptorSet[i],0,nullptr);
-
-        for(int iter=0;iter<3;++iter){
-            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
-            ,0,nullptr,0,nullptr);
-            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_Lambda);
-            vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);
-
-            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
-            ,0,nullptr,0,nullptr);
-            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_DeltaPosition);
-            vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);    
-
-            vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
-            ,0,nullptr,0,nullptr);
-            vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_PositionUpd);
-            vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1); 
-        }
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
-        ,0,nullptr,0,nullptr);
-        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_VelocityUpd);
-        vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);   
-
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
-        ,0,nullptr,0,nullptr);
-        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_VelocityCache);
-        vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);  
-
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
-        ,0,nullptr,0,nullptr);
-        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_ViscosityCorr);
-        vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);  
-
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
-        ,0,nullptr,0,nullptr);
-        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_VelocityCache);
-        vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1);  
-
-        vkCmdPipelineBarrier(SimulatingCommandBuffers[i],VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,1,&memorybarrier
-        ,0,nullptr,0,nullptr);
-        vkCmdBindPipeline(SimulatingCommandBuffers[i],VK_PIPELINE_BIND_POINT_COMPUTE,SimulatePipeline_VorticityCorr);
-        vkCmdDispatch(SimulatingCommandBuffers[i],WORK_GROUP_COUNT,1,1); 
-
-        auto result = vkEndCommandBuffer(SimulatingCommandBuffers[i]);
-        if(result != VK_SUCCESS){
-            throw std::runtime_error("failed to end simulating command buffer!");
-        }
-    }
-}
 void Renderer::RecordFluidsRenderingCommandBuffers()
 {
     for(uint32_t i=0;i<2;++i){
@@ -2188,6 +1619,7 @@ void Renderer::RecordFluidsRenderingCommandBuffers()
         for(uint32_t img_idx=0;img_idx<SwapChainImages.size();++img_idx){
 
             auto& cb = FluidsRenderingCommandBuffers[pframe][img_idx];
+            uint32_t slot = pframe*static_cast<uint32_t>(SwapChainImages.size())+img_idx;
             VkCommandBufferAllocateInfo allocateinfo{};
             allocateinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
             allocateinfo.commandPool = CommandPool;
@@ -2202,6 +1634,8 @@ void Renderer::RecordFluidsRenderingCommandBuffers()
             if(vkBeginCommandBuffer(cb,&begininfo)!=VK_SUCCESS){
                 throw std::runtime_error("failed to begin fluids rendering command buffer!");
             }
+            Profiler.BeginSlot(cb,slot);
+            Profiler.MarkStage(cb,slot,"splat");
 
             VkRenderPassBeginInfo renderpass_begininfo{};
             renderpass_begininfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -2230,9 +1664,11 @@ void Renderer::RecordFluidsRenderingCommandBuffers()
             vkCmdSetViewport(cb,0,1,&viewport);
             vkCmdSetScissor(cb,0,1,&scissor);
             VkDeviceSize offset = 0;
-            vkCmdBindVertexBuffers(cb,0,1,&ParticleBuffers[pframe],&offset);
+            VkBuffer particlebuffer = Solver.GetParticleBuffer(pframe);
+            vkCmdBindVertexBuffers(cb,0,1,&particlebuffer,&offset);
             
-            vkCmdDraw(cb,particles.size(),1,0,0);
+            //the live count moves with emitters and sinks,the solver keeps it as a draw command
+            vkCmdDrawIndirect(cb,Solver.GetParticleCountBuffer(),Solver.GetParticleDrawOffset(),1,0);
             vkCmdEndRenderPass(cb);
 
             VkImageMemoryBarrier imagebarrier{};
@@ -2251,6 +1687,7 @@ void Renderer::RecordFluidsRenderingCommandBuffers()
             vkCmdPipelineBarrier(cb,VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,0,1,&memorybarrier,0,nullptr,0,nullptr);
 
             //DEPTH TEXTURE FILTERING
+            Profiler.MarkStage(cb,slot,"bilateral filter");
             imagebarrier.image = FilteredDepthImage;
             imagebarrier.srcAccessMask = 0;
             imagebarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
@@ -2269,6 +1706,7 @@ void Renderer::RecordFluidsRenderingCommandBuffers()
             imagebarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
             vkCmdPipelineBarrier(cb,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,0,0,nullptr,0,nullptr,1,&imagebarrier);
             
+            Profiler.MarkStage(cb,slot,"postprocess");
             vkCmdBindPipeline(cb,VK_PIPELINE_BIND_POINT_COMPUTE,PostprocessPipeline);
             vkCmdBindDescriptorSets(cb,VK_PIPELINE_BIND_POINT_COMPUTE,PostprocessPipelineLayout,0,1,&PostprocessDescriptorSets[img_idx],0,nullptr);
             imagebarrier.image = SwapChainImages[img_idx];
@@ -2285,6 +1723,7 @@ void Renderer::RecordFluidsRenderingCommandBuffers()
             imagebarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
             imagebarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
             vkCmdPipelineBarrier(cb,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,0,0,nullptr,0,nullptr,1,&imagebarrier);
+            Profiler.EndSlot(cb,slot);
 
             auto result = vkEndCommandBuffer(cb);
             if(result != VK_SUCCESS){
@@ -2348,10 +1787,13 @@ void Renderer::RecordBoxRenderingCommandBuffers()
 }
 void Renderer::GetRequestInstaceExts(std::vector<const char *> &exts)
 {
-    const char** glfwexts;
-    uint32_t glfwext_count;
-    glfwexts = glfwGetRequiredInstanceExtensions(&glfwext_count);
-    exts.assign(glfwexts,glfwexts+glfwext_count);
+    exts.resize(0);
+    if(!bHeadless){
+        const char** glfwexts;
+        uint32_t glfwext_count;
+        glfwexts = glfwGetRequiredInstanceExtensions(&glfwext_count);
+        exts.assign(glfwexts,glfwexts+glfwext_count);
+    }
     if(bEnableValidation){
         exts.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
@@ -2381,6 +1823,17 @@ QueuefamliyIndices Renderer::GetPhysicalDeviceQueueFamilyIndices(VkPhysicalDevic
     vkGetPhysicalDeviceQueueFamilyProperties(pdevice,&queuefamily_count,nullptr);
     std::vector<VkQueueFamilyProperties> queuefamilies(queuefamily_count);
     vkGetPhysicalDeviceQueueFamilyProperties(pdevice,&queuefamily_count,queuefamilies.data());
+    if(bHeadless){
+        //nothing is presented,any compute family will do
+        for(uint32_t i=0;i<queuefamilies.size();++i){
+            if(queuefamilies[i].queueFlags&VK_QUEUE_COMPUTE_BIT){
+                indices.graphicNcompute = i;
+                indices.present = i;
+                break;
+            }
+        }
+        return indices;
+    }
     for(uint32_t i=0;i<queuefamilies.size();++i){
         auto& qf = queuefamilies[i];
         if((qf.queueFlags&VK_QUEUE_GRAPHICS_BIT)&&(qf.queueFlags&VK_QUEUE_COMPUTE_BIT)){
@@ -2421,6 +1874,7 @@ bool Renderer::IsPhysicalDeviceSuitable(VkPhysicalDevice pdevice)
         }
         if(!surpport) return false;
     }
+    if(bHeadless) return true;
     uint32_t surfaceformat_count;
     uint32_t surfacepresentmode_count;
     vkGetPhysicalDeviceSurfacePresentModesKHR(pdevice,Surface,&surfacepresentmode_count,nullptr);
@@ -2437,6 +1891,7 @@ bool Renderer::IsPhysicalDeviceSuitable(VkPhysicalDevice pdevice)
 void Renderer::GetRequestDeviceExts(std::vector<const char *>& exts)
 {
     exts.resize(0);
+    if(bHeadless) return;
     exts.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
  /*   exts.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
     exts.push_back(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
@@ -2448,6 +1903,13 @@ void Renderer::GetRequestDeviceExts(std::vector<const char *>& exts)
 void Renderer::GetRequestDeviceFeature(VkPhysicalDeviceFeatures& features)
 {
     features = VkPhysicalDeviceFeatures{};
+    //invocation counts are only asked for by SetStatistics,devices without them still give timings
+    if(bStatistics){
+        VkPhysicalDeviceFeatures supported;
+        vkGetPhysicalDeviceFeatures(PDevice,&supported);
+        features.pipelineStatisticsQuery = supported.pipelineStatisticsQuery;
+    }
+    if(bHeadless) return;
     features.samplerAnisotropy = VK_TRUE;
     features.fillModeNonSolid = VK_TRUE;
     features.independentBlend = VK_TRUE;
@@ -2501,6 +1963,7 @@ VkExtent2D Renderer::ChooseSwapChainImageExtents(VkSurfaceCapabilitiesKHR &capab
 }
 TickWindowResult Renderer::TickWindow(float DeltaTime)
 {
+    if(bHeadless) return TickWindowResult::NONE;
     if(glfwWindowShouldClose(Window)) return TickWindowResult::EXIT;
     glfwPollEvents();
     int w,h;
@@ -2510,21 +1973,6 @@ TickWindowResult Renderer::TickWindow(float DeltaTime)
     }
     return TickWindowResult::NONE;
 }
-void Renderer::Simulate()
-{
-    CurrentFlight = (CurrentFlight + 1)%MAXInFlightRendering; 
-    
-    VkSubmitInfo submitinfo{};
-    submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitinfo.commandBufferCount = 1;
-    submitinfo.pCommandBuffers = &SimulatingCommandBuffers[CurrentFlight];
-    submitinfo.signalSemaphoreCount = 1;
-    submitinfo.pSignalSemaphores = &SimulatingFinish;
-
-    if(vkQueueSubmit(GraphicNComputeQueue,1,&submitinfo,VK_NULL_HANDLE)!=VK_SUCCESS){
-        throw std::runtime_error("failed to submit simulating command buffer!");
-    }
-}
 void Renderer::BoxRender(uint32_t dstimage)
 {
     VkSubmitInfo rendering_submitinfo{};
@@ -2543,10 +1991,12 @@ void Renderer::FluidsRender(uint32_t dstimage)
     VkSubmitInfo rendering_submitinfo{};
     rendering_submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     rendering_submitinfo.commandBufferCount = 1;
-    rendering_submitinfo.pCommandBuffers = &FluidsRenderingCommandBuffers[CurrentFlight][dstimage];
-    std::array<VkSemaphore,3> rendering_waitsems = {ImageAvaliable,SimulatingFinish,BoxRenderingFinish};
-    std::array<VkPipelineStageFlags,3> rendering_waitstages = {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT};
-    rendering_submitinfo.waitSemaphoreCount = static_cast<uint32_t>(rendering_waitsems.size());
+    rendering_submitinfo.pCommandBuffers = &FluidsRenderingCommandBuffers[Solver.GetCurrentFlight()][dstimage];
+    VkSemaphore simulatingfinish = Solver.TakeSimulatingSemaphore();
+    std::array<VkSemaphore,3> rendering_waitsems = {ImageAvaliable,BoxRenderingFinish,simulatingfinish};
+    std::array<VkPipelineStageFlags,3> rendering_waitstages = {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT|VK_PIPELINE_STAGE_VERTEX_INPUT_BIT};
+    //frames without a simulating step since the last draw just show the latest state again
+    rendering_submitinfo.waitSemaphoreCount = simulatingfinish != VK_NULL_HANDLE ? 3 : 2;
     rendering_submitinfo.pWaitSemaphores = rendering_waitsems.data();
     rendering_submitinfo.pWaitDstStageMask = rendering_waitstages.data();
     rendering_submitinfo.pSignalSemaphores = &FluidsRenderingFinish;
@@ -2554,9 +2004,13 @@ void Renderer::FluidsRender(uint32_t dstimage)
     if(vkQueueSubmit(GraphicNComputeQueue,1,&rendering_submitinfo,DrawingFence)!=VK_SUCCESS){
         throw std::runtime_error("failed to submit fluids rendering command buffer!");
     }
+    Profiler.MarkSubmitted(Solver.GetCurrentFlight()*static_cast<uint32_t>(SwapChainImages.size())+dstimage);
 }
 void Renderer::Draw()
 {
+    if(bHeadless){
+        throw std::runtime_error("you should not draw in headless mode!");
+    }
     uint64_t notimeout = UINT64_MAX;
     VkResult result;
     
@@ -2564,6 +2018,8 @@ void Renderer::Draw()
     
     vkWaitForFences(LDevice,1,&DrawingFence,VK_TRUE,notimeout);
     vkResetFences(LDevice,1,&DrawingFence);
+    //the last frame is done,its timings are in
+    Profiler.Collect();
 
     result = vkAcquireNextImageKHR(LDevice,SwapChain,notimeout,ImageAvaliable,VK_NULL_HANDLE,&image_idx);   
 
@@ -2587,4 +2043,7 @@ void Renderer::Draw()
 void Renderer::WaitIdle()
 {
     vkDeviceWaitIdle(LDevice);
+    //the frame and the steps submitted last are done too
+    Profiler.Collect();
+    Solver.WaitIdle();
 }
@@ -0,0 +1,82 @@
+#include"workerpool.h"
+#include<algorithm>
+
+WorkerPool::WorkerPool(uint32_t threads)
+{
+    if(threads == 0){
+        threads = std::max(1u,std::thread::hardware_concurrency());
+    }
+    for(uint32_t i=1;i<threads;++i){
+        workers.emplace_back(&WorkerPool::WorkerLoop,this,i);
+    }
+}
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for(auto& worker:workers){
+        worker.join();
+    }
+}
+
+void WorkerPool::Run(uint32_t blocks,const std::function<void(uint32_t,uint32_t)>& fn)
+{
+    if(blocks == 0){
+        return;
+    }
+    //not worth waking anyone for
+    if(blocks == 1 || workers.empty()){
+        for(uint32_t block=0;block<blocks;++block){
+            fn(block,0);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        blockcount = blocks;
+        cursor.store(0,std::memory_order_relaxed);
+        busy = static_cast<uint32_t>(workers.size());
+        ++generation;
+    }
+    wake.notify_all();
+    RunBlocks(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock,[this]{ return busy == 0; });
+    job = nullptr;
+}
+
+void WorkerPool::RunBlocks(uint32_t thread)
+{
+    for(;;){
+        uint32_t block = cursor.fetch_add(1,std::memory_order_relaxed);
+        if(block >= blockcount){
+            return;
+        }
+        (*job)(block,thread);
+    }
+}
+
+void WorkerPool::WorkerLoop(uint32_t thread)
+{
+    uint64_t seen = 0;
+    for(;;){
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock,[&]{ return stop || generation != seen; });
+            if(stop){
+                return;
+            }
+            seen = generation;
+        }
+        RunBlocks(thread);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busy;
+        }
+        done.notify_one();
+    }
+}